@@ -0,0 +1,76 @@
+#include "core/bus_memory_map.h"
+#include <gtest/gtest.h>
+
+using Bus::MemoryRegion;
+
+// The compare chain that DoMemoryAccess used to decode physical addresses with, which the memory map has to match.
+static MemoryRegion ReferenceGetMemoryRegion(PhysicalMemoryAddress address)
+{
+  using namespace Bus;
+
+  if (address < 0x800000)
+    return MemoryRegion::RAM;
+  else if (address < EXP1_BASE)
+    return MemoryRegion::Invalid;
+  else if (address < (EXP1_BASE + EXP1_SIZE))
+    return MemoryRegion::EXP1;
+  else if (address < MEMCTRL_BASE)
+    return MemoryRegion::Invalid;
+  else if (address < (MEMCTRL_BASE + MEMCTRL_SIZE))
+    return MemoryRegion::MemoryControl;
+  else if (address < (PAD_BASE + PAD_SIZE))
+    return MemoryRegion::Pad;
+  else if (address < (SIO_BASE + SIO_SIZE))
+    return MemoryRegion::SIO;
+  else if (address < (MEMCTRL2_BASE + MEMCTRL2_SIZE))
+    return MemoryRegion::MemoryControl2;
+  else if (address < (INTERRUPT_CONTROLLER_BASE + INTERRUPT_CONTROLLER_SIZE))
+    return MemoryRegion::InterruptController;
+  else if (address < (DMA_BASE + DMA_SIZE))
+    return MemoryRegion::DMA;
+  else if (address < (TIMERS_BASE + TIMERS_SIZE))
+    return MemoryRegion::Timers;
+  else if (address < CDROM_BASE)
+    return MemoryRegion::Invalid;
+  else if (address < (CDROM_BASE + GPU_SIZE))
+    return MemoryRegion::CDROM;
+  else if (address < (GPU_BASE + GPU_SIZE))
+    return MemoryRegion::GPU;
+  else if (address < (MDEC_BASE + MDEC_SIZE))
+    return MemoryRegion::MDEC;
+  else if (address < SPU_BASE)
+    return MemoryRegion::Invalid;
+  else if (address < (SPU_BASE + SPU_SIZE))
+    return MemoryRegion::SPU;
+  else if (address < EXP2_BASE)
+    return MemoryRegion::Invalid;
+  else if (address < (EXP2_BASE + EXP2_SIZE))
+    return MemoryRegion::EXP2;
+  else if (address < BIOS_BASE)
+    return MemoryRegion::Invalid;
+  else if (address < (BIOS_BASE + BIOS_SIZE))
+    return MemoryRegion::BIOS;
+  else
+    return MemoryRegion::Invalid;
+}
+
+TEST(BusMemoryMap, IOPageMatchesReference)
+{
+  for (u32 offset = 0; offset <= Bus::IO_PAGE_MASK; offset++)
+  {
+    const PhysicalMemoryAddress address = Bus::IO_PAGE_BASE + offset;
+    ASSERT_EQ(Bus::GetMappedMemoryRegion(address), ReferenceGetMemoryRegion(address)) << "address " << address;
+  }
+}
+
+TEST(BusMemoryMap, AllPhysicalMemoryMatchesReference)
+{
+  // Regions are all multiples of the I/O map granule, so checking the start of each granule covers every boundary.
+  constexpr u32 step = 1u << Bus::IO_MAP_GRANULE_SHIFT;
+  for (u32 address = 0; address <= CPU::PHYSICAL_MEMORY_ADDRESS_MASK; address += step)
+  {
+    ASSERT_EQ(Bus::GetMappedMemoryRegion(address), ReferenceGetMemoryRegion(address)) << "address " << address;
+    ASSERT_EQ(Bus::GetMappedMemoryRegion(address + step - 1), ReferenceGetMemoryRegion(address + step - 1))
+      << "address " << (address + step - 1);
+  }
+}
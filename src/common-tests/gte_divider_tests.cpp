@@ -0,0 +1,74 @@
+#include "core/gte_divider.h"
+#include <gtest/gtest.h>
+
+// The branching version of the divider, which the table-driven one has to match exactly.
+static u32 ReferenceUNRDivide(u32 lhs, u32 rhs, bool* overflow)
+{
+  *overflow = false;
+  if (rhs * 2 <= lhs)
+  {
+    *overflow = true;
+    return 0x1FFFF;
+  }
+
+  const u32 shift = (rhs == 0) ? 16 : CountLeadingZeros(static_cast<u16>(rhs));
+  lhs <<= shift;
+  rhs <<= shift;
+
+  const u32 divisor = rhs | 0x8000;
+  const s32 x = static_cast<s32>(0x101 + ZeroExtend32(GTE::UNR_TABLE[((divisor & 0x7FFF) + 0x40) >> 7]));
+  const s32 d = ((static_cast<s32>(ZeroExtend32(divisor)) * -x) + 0x80) >> 8;
+  const u32 recip = static_cast<u32>(((x * (0x20000 + d)) + 0x80) >> 8);
+
+  const u32 result = Truncate32((ZeroExtend64(lhs) * ZeroExtend64(recip) + u64(0x8000)) >> 16);
+  return std::min<u32>(0x1FFFF, result);
+}
+
+TEST(GTEDivider, KnownValues)
+{
+  bool overflow;
+  ASSERT_EQ(GTE::UNRDivide(0x1000, 0x2000, &overflow), 0x8000u);
+  ASSERT_FALSE(overflow);
+  ASSERT_EQ(GTE::UNRDivide(0xFE3F, 0x7F20, &overflow), 0x1FFFFu);
+  ASSERT_FALSE(overflow);
+  ASSERT_EQ(GTE::UNRDivide(0x0001, 0x0000, &overflow), 0x1FFFFu);
+  ASSERT_TRUE(overflow);
+  ASSERT_EQ(GTE::UNRDivide(0x0000, 0x0000, &overflow), 0x1FFFFu);
+  ASSERT_TRUE(overflow);
+}
+
+static void CheckAgainstReference(u32 lhs, u32 rhs)
+{
+  bool overflow, expected_overflow;
+  const u32 result = GTE::UNRDivide(lhs, rhs, &overflow);
+  const u32 expected = ReferenceUNRDivide(lhs, rhs, &expected_overflow);
+  ASSERT_EQ(result, expected) << "lhs=" << lhs << " rhs=" << rhs;
+  ASSERT_EQ(overflow, expected_overflow) << "lhs=" << lhs << " rhs=" << rhs;
+}
+
+TEST(GTEDivider, MatchesReferenceForAllReciprocals)
+{
+  // Every divisor at the edges of the overflow check, which also covers every table entry and normalization shift.
+  for (u32 rhs = 0; rhs <= 0xFFFF; rhs++)
+  {
+    if (rhs > 0)
+      CheckAgainstReference(std::min<u32>(rhs * 2, 0x10000) - 1, rhs);
+    CheckAgainstReference(std::min<u32>(rhs * 2, 0xFFFF), rhs);
+    CheckAgainstReference(rhs, rhs);
+    CheckAgainstReference(0, rhs);
+    if (HasFatalFailure())
+      return;
+  }
+}
+
+TEST(GTEDivider, MatchesReferenceForAllDivisors)
+{
+  for (u32 rhs = 0; rhs <= 0xFFFF; rhs++)
+  {
+    for (u32 lhs = 0; lhs <= 0xFFFF; lhs += 0x33)
+      CheckAgainstReference(lhs, rhs);
+
+    if (HasFatalFailure())
+      return;
+  }
+}
@@ -0,0 +1,73 @@
+#include "core/gte_transform.h"
+#include <gtest/gtest.h>
+#include <iterator>
+#include <random>
+
+namespace {
+struct TransformInputs
+{
+  s16 RT[3][3];
+  s32 TR[3];
+  s16 V[3][3];
+};
+} // namespace
+
+// Mostly random values, with some at the limits so the 44-bit overflow checks are hit from both sides.
+static TransformInputs GenerateInputs(std::mt19937& rng)
+{
+  static constexpr s32 tr_edges[] = {INT32_MIN, INT32_MIN + 1, -(1 << 19), 0, (1 << 19) - 1, INT32_MAX - 1, INT32_MAX};
+  static constexpr s16 s16_edges[] = {INT16_MIN, -1, 0, 1, INT16_MAX};
+
+  TransformInputs in;
+  for (u32 i = 0; i < 3; i++)
+  {
+    in.TR[i] = (rng() & 3) ? static_cast<s32>(rng()) : tr_edges[rng() % std::size(tr_edges)];
+    for (u32 j = 0; j < 3; j++)
+    {
+      in.RT[i][j] = (rng() & 3) ? static_cast<s16>(rng()) : s16_edges[rng() % std::size(s16_edges)];
+      in.V[i][j] = (rng() & 3) ? static_cast<s16>(rng()) : s16_edges[rng() % std::size(s16_edges)];
+    }
+  }
+
+  return in;
+}
+
+TEST(GTETransform, ScalarFlagsOverflow)
+{
+  const s16 RT[3][3] = {{INT16_MAX, INT16_MAX, INT16_MAX}, {INT16_MIN, 0, 0}, {0, 0, 0}};
+  const s32 TR[3] = {INT32_MAX, INT32_MIN, 0};
+  const s16 V0[3] = {INT16_MAX, INT16_MAX, INT16_MAX};
+  const s16* const V[1] = {V0};
+  s64 out[1][3];
+  const u32 flags = GTE::TransformVerticesScalar(RT, TR, V, 1, out);
+  ASSERT_EQ(flags, (UINT32_C(1) << 30) | (UINT32_C(1) << 26));
+  ASSERT_EQ(out[0][2], 0);
+}
+
+#if defined(CPU_X64)
+
+TEST(GTETransform, SSE41MatchesScalar)
+{
+  if (!GTE::CanUseTransformVerticesSSE41())
+    GTEST_SKIP();
+
+  std::mt19937 rng(0x47544521);
+  for (u32 iteration = 0; iteration < 1000000; iteration++)
+  {
+    const TransformInputs in = GenerateInputs(rng);
+    const s16* const V[3] = {in.V[0], in.V[1], in.V[2]};
+    const u32 count = (iteration & 1) ? 3 : 1;
+
+    s64 expected[3][3], result[3][3];
+    const u32 expected_flags = GTE::TransformVerticesScalar(in.RT, in.TR, V, count, expected);
+    const u32 flags = GTE::TransformVerticesSSE41(in.RT, in.TR, V, count, result);
+    ASSERT_EQ(flags, expected_flags) << "iteration " << iteration;
+    for (u32 n = 0; n < count; n++)
+    {
+      for (u32 i = 0; i < 3; i++)
+        ASSERT_EQ(result[n][i], expected[n][i]) << "iteration " << iteration << " vertex " << n << " row " << i;
+    }
+  }
+}
+
+#endif
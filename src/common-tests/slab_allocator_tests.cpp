@@ -0,0 +1,45 @@
+#include "common/slab_allocator.h"
+#include <gtest/gtest.h>
+
+TEST(SlabAllocator, AllocationsAreContiguousWithinSlab)
+{
+  SlabAllocator<u32, 16> allocator;
+  u32* a = allocator.Allocate(4);
+  u32* b = allocator.Allocate(4);
+  ASSERT_EQ(b, a + 4);
+  ASSERT_EQ(allocator.GetAllocatedCount(), 8u);
+  ASSERT_EQ(allocator.GetSlabCount(), 1u);
+}
+
+TEST(SlabAllocator, AllocationDoesNotSpanSlabs)
+{
+  SlabAllocator<u32, 16> allocator;
+  u32* a = allocator.Allocate(12);
+  u32* b = allocator.Allocate(8);
+  ASSERT_NE(b, a + 12);
+  ASSERT_EQ(allocator.GetSlabCount(), 2u);
+}
+
+TEST(SlabAllocator, LargeAllocationGetsOwnSlab)
+{
+  SlabAllocator<u32, 16> allocator;
+  u32* a = allocator.Allocate(64);
+  a[63] = 1;
+  ASSERT_EQ(allocator.GetAllocatedCount(), 64u);
+  ASSERT_EQ(allocator.GetSlabCount(), 1u);
+}
+
+TEST(SlabAllocator, ResetReusesSlabs)
+{
+  SlabAllocator<u32, 16> allocator;
+  u32* a = allocator.Allocate(12);
+  allocator.Allocate(12);
+  allocator.Reset();
+  ASSERT_EQ(allocator.GetAllocatedCount(), 0u);
+  ASSERT_EQ(allocator.Allocate(12), a);
+  allocator.Allocate(12);
+  ASSERT_EQ(allocator.GetSlabCount(), 2u);
+
+  allocator.Clear();
+  ASSERT_EQ(allocator.GetSlabCount(), 0u);
+}
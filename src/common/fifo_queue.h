@@ -23,7 +23,7 @@ public:
   T* GetWritePointer() { return &m_ptr[m_tail]; }
   u32 GetSize() const { return m_size; }
   u32 GetSpace() const { return CAPACITY - m_size; }
-  u32 GetContiguousSpace() const { return (m_tail >= m_head) ? (CAPACITY - m_tail) : (m_head - m_tail); }
+  u32 GetContiguousSpace() const { return (m_tail >= m_head && !IsFull()) ? (CAPACITY - m_tail) : (m_head - m_tail); }
   u32 GetContiguousSize() const { return std::min<u32>(CAPACITY - m_head, m_size); }
   bool IsEmpty() const { return m_size == 0; }
   bool IsFull() const { return m_size == CAPACITY; }
@@ -151,7 +151,7 @@ public:
 
   void AdvanceTail(u32 count)
   {
-    DebugAssert((m_size + count) < CAPACITY);
+    DebugAssert((m_size + count) <= CAPACITY);
     DebugAssert((m_tail + count) <= CAPACITY);
     m_tail = (m_tail + count) % CAPACITY;
     m_size += count;
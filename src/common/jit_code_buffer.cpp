@@ -112,7 +112,8 @@ bool JitCodeBuffer::Initialize(void* buffer, u32 size, u32 far_code_size /* = 0
   m_code_size = size - far_code_size - (guard_size * 2);
   m_code_used = 0;
 
-  m_far_code_ptr = static_cast<u8*>(m_code_ptr) + m_code_size;
+  // far code follows the near code, which starts after the guard
+  m_far_code_ptr = m_free_code_ptr + m_code_size;
   m_free_far_code_ptr = m_far_code_ptr;
   m_far_code_size = far_code_size - guard_size;
   m_far_code_used = 0;
@@ -0,0 +1,218 @@
+#include "memory_arena.h"
+#include "common/assert.h"
+#include "common/log.h"
+#include "common/string_util.h"
+Log_SetChannel(Common::MemoryArena);
+
+#if defined(WIN32)
+#include "common/windows_headers.h"
+#elif defined(__linux__) || defined(__ANDROID__) || defined(__APPLE__)
+#include <cerrno>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+namespace Common {
+
+MemoryArena::MemoryArena() = default;
+
+MemoryArena::~MemoryArena()
+{
+  Destroy();
+}
+
+bool MemoryArena::Create(size_t size, bool writable, bool executable)
+{
+  if (IsValid())
+    Destroy();
+
+#if defined(WIN32)
+  const std::string file_mapping_name =
+    StringUtil::StdStringFromFormat("duckstation_%u", static_cast<unsigned>(GetCurrentProcessId()));
+
+  const DWORD protect = (writable ? (executable ? PAGE_EXECUTE_READWRITE : PAGE_READWRITE) : PAGE_READONLY);
+  m_file_handle = CreateFileMappingA(INVALID_HANDLE_VALUE, nullptr, protect, Truncate32(size >> 32), Truncate32(size),
+                                     file_mapping_name.c_str());
+  if (!m_file_handle)
+  {
+    Log_ErrorPrintf("CreateFileMapping failed: %u", static_cast<unsigned>(GetLastError()));
+    return false;
+  }
+#elif defined(__linux__) || defined(__ANDROID__) || defined(__APPLE__)
+  const std::string file_mapping_name =
+    StringUtil::StdStringFromFormat("duckstation_%u", static_cast<unsigned>(getpid()));
+
+  const int flags = writable ? O_RDWR : O_RDONLY;
+  m_shmem_fd = shm_open(file_mapping_name.c_str(), flags | O_CREAT | O_EXCL, 0600);
+  if (m_shmem_fd < 0)
+  {
+    Log_ErrorPrintf("shm_open failed: %d", errno);
+    return false;
+  }
+
+  // we're not going to be opening this mapping in other processes, so remove the file
+  shm_unlink(file_mapping_name.c_str());
+
+  // ensure it's the correct size
+  if (ftruncate(m_shmem_fd, static_cast<off_t>(size)) < 0)
+  {
+    Log_ErrorPrintf("ftruncate(%zu) failed: %d", size, errno);
+    close(m_shmem_fd);
+    m_shmem_fd = -1;
+    return false;
+  }
+#else
+  return false;
+#endif
+
+  m_size = size;
+  m_writable = writable;
+  m_executable = executable;
+  return true;
+}
+
+void MemoryArena::Destroy()
+{
+#if defined(WIN32)
+  if (m_file_handle)
+  {
+    CloseHandle(m_file_handle);
+    m_file_handle = nullptr;
+  }
+#elif defined(__linux__) || defined(__ANDROID__) || defined(__APPLE__)
+  if (m_shmem_fd >= 0)
+  {
+    close(m_shmem_fd);
+    m_shmem_fd = -1;
+  }
+#endif
+
+  m_size = 0;
+}
+
+std::optional<MemoryArena::View> MemoryArena::CreateView(size_t offset, size_t size, bool writable, bool executable,
+                                                         void* fixed_address /* = nullptr */)
+{
+  void* base_pointer = CreateViewPtr(offset, size, writable, executable, fixed_address);
+  if (!base_pointer)
+    return std::nullopt;
+
+  return View(this, base_pointer, offset, size, writable, fixed_address != nullptr);
+}
+
+void* MemoryArena::CreateViewPtr(size_t offset, size_t size, bool writable, bool executable,
+                                 void* fixed_address /* = nullptr */)
+{
+  void* base_pointer;
+#if defined(WIN32)
+  const DWORD desired_access = FILE_MAP_READ | (writable ? FILE_MAP_WRITE : 0) | (executable ? FILE_MAP_EXECUTE : 0);
+  base_pointer =
+    MapViewOfFileEx(m_file_handle, desired_access, Truncate32(offset >> 32), Truncate32(offset), size, fixed_address);
+  if (!base_pointer)
+    return nullptr;
+#elif defined(__linux__) || defined(__ANDROID__) || defined(__APPLE__)
+  const int flags = (fixed_address != nullptr) ? (MAP_SHARED | MAP_FIXED) : MAP_SHARED;
+  const int prot = PROT_READ | (writable ? PROT_WRITE : 0) | (executable ? PROT_EXEC : 0);
+  base_pointer = mmap(fixed_address, size, prot, flags, m_shmem_fd, static_cast<off_t>(offset));
+  if (base_pointer == reinterpret_cast<void*>(-1))
+    return nullptr;
+#else
+  return nullptr;
+#endif
+
+  return base_pointer;
+}
+
+bool MemoryArena::ReleaseViewPtr(void* address, size_t size, bool placed)
+{
+#if defined(WIN32)
+  return static_cast<bool>(UnmapViewOfFile(address));
+#elif defined(__linux__) || defined(__ANDROID__) || defined(__APPLE__)
+  if (placed)
+  {
+    // Replace the mapping with an inaccessible one, so the hole can't be claimed by another allocation.
+    return (mmap(address, size, PROT_NONE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_FIXED | MAP_NORESERVE, -1, 0) !=
+            reinterpret_cast<void*>(-1));
+  }
+
+  return (munmap(address, size) == 0);
+#else
+  return false;
+#endif
+}
+
+void* MemoryArena::ReserveAddressSpace(size_t size)
+{
+#if defined(WIN32)
+  void* base_address = VirtualAlloc(nullptr, size, MEM_RESERVE, PAGE_READWRITE);
+  if (!base_address)
+    return nullptr;
+
+  VirtualFree(base_address, 0, MEM_RELEASE);
+  return base_address;
+#elif defined(__linux__) || defined(__ANDROID__) || defined(__APPLE__)
+  void* base_address = mmap(nullptr, size, PROT_NONE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+  if (base_address == reinterpret_cast<void*>(-1))
+    return nullptr;
+
+  return base_address;
+#else
+  return nullptr;
+#endif
+}
+
+void MemoryArena::ReleaseAddressSpace(void* address, size_t size)
+{
+#if defined(WIN32)
+  // Nothing to do, the region was never held.
+#elif defined(__linux__) || defined(__ANDROID__) || defined(__APPLE__)
+  munmap(address, size);
+#endif
+}
+
+bool MemoryArena::SetPageProtection(void* address, size_t length, bool readable, bool writable, bool executable)
+{
+#if defined(WIN32)
+  static constexpr DWORD protection_table[2][2][2] = {
+    {{PAGE_NOACCESS, PAGE_EXECUTE}, {PAGE_WRITECOPY, PAGE_EXECUTE_WRITECOPY}},
+    {{PAGE_READONLY, PAGE_EXECUTE_READ}, {PAGE_READWRITE, PAGE_EXECUTE_READWRITE}}};
+
+  DWORD old_protect;
+  return static_cast<bool>(
+    VirtualProtect(address, length, protection_table[readable][writable][executable], &old_protect));
+#elif defined(__linux__) || defined(__ANDROID__) || defined(__APPLE__)
+  const int prot = (readable ? PROT_READ : 0) | (writable ? PROT_WRITE : 0) | (executable ? PROT_EXEC : 0);
+  return (mprotect(address, length, prot) >= 0);
+#else
+  return false;
+#endif
+}
+
+MemoryArena::View::View(MemoryArena* parent, void* base_pointer, size_t arena_offset, size_t mapping_size,
+                        bool writable, bool placed)
+  : m_parent(parent), m_base_pointer(base_pointer), m_arena_offset(arena_offset), m_mapping_size(mapping_size),
+    m_writable(writable), m_placed(placed)
+{
+}
+
+MemoryArena::View::View(View&& view)
+  : m_parent(view.m_parent), m_base_pointer(view.m_base_pointer), m_arena_offset(view.m_arena_offset),
+    m_mapping_size(view.m_mapping_size), m_writable(view.m_writable), m_placed(view.m_placed)
+{
+  view.m_parent = nullptr;
+  view.m_base_pointer = nullptr;
+  view.m_arena_offset = 0;
+  view.m_mapping_size = 0;
+}
+
+MemoryArena::View::~View()
+{
+  if (m_parent)
+  {
+    if (!m_parent->ReleaseViewPtr(m_base_pointer, m_mapping_size, m_placed))
+      Panic("Failed to unmap view");
+  }
+}
+
+} // namespace Common
@@ -0,0 +1,68 @@
+#pragma once
+#include "types.h"
+#include <optional>
+
+namespace Common {
+
+class MemoryArena
+{
+public:
+  class View
+  {
+  public:
+    View(MemoryArena* parent, void* base_pointer, size_t arena_offset, size_t mapping_size, bool writable,
+         bool placed);
+    View(View&& view);
+    ~View();
+
+    void* GetBasePointer() const { return m_base_pointer; }
+    size_t GetArenaOffset() const { return m_arena_offset; }
+    size_t GetMappingSize() const { return m_mapping_size; }
+    bool IsWritable() const { return m_writable; }
+
+  private:
+    MemoryArena* m_parent;
+    void* m_base_pointer;
+    size_t m_arena_offset;
+    size_t m_mapping_size;
+    bool m_writable;
+    bool m_placed;
+  };
+
+  MemoryArena();
+  ~MemoryArena();
+
+  bool IsValid() const { return (m_size > 0); }
+  size_t GetSize() const { return m_size; }
+
+  bool Create(size_t size, bool writable, bool executable);
+  void Destroy();
+
+  /// Maps a region of the arena into the address space. If fixed_address is specified, the view is placed inside a
+  /// region previously returned by ReserveAddressSpace(), and will be returned to the reservation when released.
+  std::optional<View> CreateView(size_t offset, size_t size, bool writable, bool executable,
+                                 void* fixed_address = nullptr);
+
+  void* CreateViewPtr(size_t offset, size_t size, bool writable, bool executable, void* fixed_address = nullptr);
+  bool ReleaseViewPtr(void* address, size_t size, bool placed);
+
+  /// Reserves a contiguous region of address space, which views can later be placed in.
+  /// On Windows, the reservation cannot be held while mapping views, so this only locates a free region.
+  static void* ReserveAddressSpace(size_t size);
+  static void ReleaseAddressSpace(void* address, size_t size);
+
+  static bool SetPageProtection(void* address, size_t length, bool readable, bool writable, bool executable);
+
+private:
+#if defined(WIN32)
+  void* m_file_handle = nullptr;
+#elif defined(__linux__) || defined(__ANDROID__) || defined(__APPLE__)
+  int m_shmem_fd = -1;
+#endif
+
+  size_t m_size = 0;
+  bool m_writable = false;
+  bool m_executable = false;
+};
+
+} // namespace Common
@@ -0,0 +1,204 @@
+#include "page_fault_handler.h"
+#include "common/cpu_detect.h"
+#include "common/log.h"
+#include <algorithm>
+#include <mutex>
+#include <vector>
+Log_SetChannel(Common::PageFaultHandler);
+
+#if defined(WIN32)
+#include "common/windows_headers.h"
+#elif defined(__linux__) || defined(__ANDROID__) || defined(__APPLE__)
+#include <signal.h>
+#include <ucontext.h>
+#endif
+
+namespace Common::PageFaultHandler {
+
+struct RegisteredHandler
+{
+  void* owner;
+  Callback callback;
+};
+
+static std::vector<RegisteredHandler> m_handlers;
+static std::mutex m_handler_lock;
+static bool m_in_exception_handler = false;
+
+#if defined(CPU_X64)
+
+static bool IsSupportedHost()
+{
+  return true;
+}
+
+#else
+
+static bool IsSupportedHost()
+{
+  return false;
+}
+
+#endif
+
+static HandlerResult DispatchToHandlers(void* exception_pc, void* fault_address, bool is_write)
+{
+  std::lock_guard<std::mutex> guard(m_handler_lock);
+  for (const RegisteredHandler& rh : m_handlers)
+  {
+    if (rh.callback(exception_pc, fault_address, is_write) == HandlerResult::ContinueExecution)
+      return HandlerResult::ContinueExecution;
+  }
+
+  return HandlerResult::ExecuteNextHandler;
+}
+
+#if defined(WIN32) && defined(CPU_X64)
+
+static PVOID s_veh_handle = nullptr;
+
+static LONG ExceptionHandler(PEXCEPTION_POINTERS exi)
+{
+  if (exi->ExceptionRecord->ExceptionCode != EXCEPTION_ACCESS_VIOLATION || m_in_exception_handler)
+    return EXCEPTION_CONTINUE_SEARCH;
+
+  m_in_exception_handler = true;
+
+  void* const exception_pc = reinterpret_cast<void*>(exi->ContextRecord->Rip);
+  void* const exception_address = reinterpret_cast<void*>(exi->ExceptionRecord->ExceptionInformation[1]);
+  const bool is_write = exi->ExceptionRecord->ExceptionInformation[0] == 1;
+
+  const HandlerResult result = DispatchToHandlers(exception_pc, exception_address, is_write);
+
+  m_in_exception_handler = false;
+  return (result == HandlerResult::ContinueExecution) ? EXCEPTION_CONTINUE_EXECUTION : EXCEPTION_CONTINUE_SEARCH;
+}
+
+static bool InstallSystemHandler()
+{
+  s_veh_handle = AddVectoredExceptionHandler(1, ExceptionHandler);
+  return (s_veh_handle != nullptr);
+}
+
+static void RemoveSystemHandler()
+{
+  if (s_veh_handle)
+  {
+    RemoveVectoredExceptionHandler(s_veh_handle);
+    s_veh_handle = nullptr;
+  }
+}
+
+#elif (defined(__linux__) || defined(__ANDROID__) || defined(__APPLE__)) && defined(CPU_X64)
+
+static struct sigaction s_old_sigsegv_action;
+#if defined(__APPLE__)
+static struct sigaction s_old_sigbus_action;
+#endif
+
+static void SIGSEGVHandler(int sig, siginfo_t* info, void* ctx)
+{
+  if ((info->si_code != SEGV_MAPERR && info->si_code != SEGV_ACCERR) || m_in_exception_handler)
+    goto chain;
+
+  {
+    m_in_exception_handler = true;
+
+#if defined(__APPLE__)
+    void* const exception_pc = reinterpret_cast<void*>(static_cast<ucontext_t*>(ctx)->uc_mcontext->__ss.__rip);
+    const bool is_write = (static_cast<ucontext_t*>(ctx)->uc_mcontext->__es.__err & 2) != 0;
+#else
+    void* const exception_pc = reinterpret_cast<void*>(static_cast<ucontext_t*>(ctx)->uc_mcontext.gregs[REG_RIP]);
+    const bool is_write = (static_cast<ucontext_t*>(ctx)->uc_mcontext.gregs[REG_ERR] & 2) != 0;
+#endif
+
+    const HandlerResult result = DispatchToHandlers(exception_pc, info->si_addr, is_write);
+    m_in_exception_handler = false;
+    if (result == HandlerResult::ContinueExecution)
+      return;
+  }
+
+chain:
+  // Call the old signal handler.
+#if defined(__APPLE__)
+  const struct sigaction& sa = (sig == SIGBUS) ? s_old_sigbus_action : s_old_sigsegv_action;
+#else
+  const struct sigaction& sa = s_old_sigsegv_action;
+#endif
+  if (sa.sa_flags & SA_SIGINFO)
+    sa.sa_sigaction(sig, info, ctx);
+  else if (sa.sa_handler == SIG_DFL)
+    signal(sig, SIG_DFL);
+  else if (sa.sa_handler == SIG_IGN)
+    return;
+  else
+    sa.sa_handler(sig);
+}
+
+static bool InstallSystemHandler()
+{
+  struct sigaction sa = {};
+  sa.sa_sigaction = SIGSEGVHandler;
+  sa.sa_flags = SA_SIGINFO;
+  sigemptyset(&sa.sa_mask);
+  if (sigaction(SIGSEGV, &sa, &s_old_sigsegv_action) < 0)
+    return false;
+#if defined(__APPLE__)
+  if (sigaction(SIGBUS, &sa, &s_old_sigbus_action) < 0)
+    return false;
+#endif
+
+  return true;
+}
+
+static void RemoveSystemHandler()
+{
+  sigaction(SIGSEGV, &s_old_sigsegv_action, nullptr);
+#if defined(__APPLE__)
+  sigaction(SIGBUS, &s_old_sigbus_action, nullptr);
+#endif
+}
+
+#else
+
+static bool InstallSystemHandler()
+{
+  return false;
+}
+
+static void RemoveSystemHandler() {}
+
+#endif
+
+bool InstallHandler(void* owner, Callback callback)
+{
+  if (!IsSupportedHost())
+    return false;
+
+  std::lock_guard<std::mutex> guard(m_handler_lock);
+  if (m_handlers.empty() && !InstallSystemHandler())
+  {
+    Log_ErrorPrint("Failed to install system page fault handler");
+    return false;
+  }
+
+  m_handlers.push_back(RegisteredHandler{owner, callback});
+  return true;
+}
+
+bool RemoveHandler(void* owner)
+{
+  std::lock_guard<std::mutex> guard(m_handler_lock);
+  auto it = std::find_if(m_handlers.begin(), m_handlers.end(),
+                         [owner](const RegisteredHandler& rh) { return rh.owner == owner; });
+  if (it == m_handlers.end())
+    return false;
+
+  m_handlers.erase(it);
+  if (m_handlers.empty())
+    RemoveSystemHandler();
+
+  return true;
+}
+
+} // namespace Common::PageFaultHandler
@@ -0,0 +1,19 @@
+#pragma once
+#include "types.h"
+
+namespace Common::PageFaultHandler {
+
+enum class HandlerResult
+{
+  ContinueExecution,
+  ExecuteNextHandler,
+};
+
+using Callback = HandlerResult (*)(void* exception_pc, void* fault_address, bool is_write);
+
+/// Registers a callback which is invoked on access violations. Handlers are called in registration order, until one
+/// returns ContinueExecution. Only supported on x64 hosts.
+bool InstallHandler(void* owner, Callback callback);
+bool RemoveHandler(void* owner);
+
+} // namespace Common::PageFaultHandler
@@ -0,0 +1,72 @@
+#pragma once
+#include "types.h"
+#include <algorithm>
+#include <memory>
+#include <vector>
+
+/// Hands out contiguous runs of objects from large slabs, which are only released all at once by Reset().
+/// Slabs are kept after a reset, so once warmed up, allocating does not touch the heap. Objects are not destroyed or
+/// reconstructed when their memory is reused, so the caller is responsible for reinitializing them.
+template<typename T, u32 SLAB_SIZE>
+class SlabAllocator
+{
+public:
+  /// Returns a pointer to count contiguous objects. Never fails, a new slab is created if needed.
+  T* Allocate(u32 count = 1)
+  {
+    for (;;)
+    {
+      if (m_current_slab == m_slabs.size())
+      {
+        const u32 slab_size = std::max(SLAB_SIZE, count);
+        m_slabs.push_back(Slab{std::make_unique<T[]>(slab_size), slab_size});
+      }
+
+      Slab& slab = m_slabs[m_current_slab];
+      if ((slab.size - m_slab_used) >= count)
+      {
+        T* ptr = slab.data.get() + m_slab_used;
+        m_slab_used += count;
+        m_allocated_count += count;
+        return ptr;
+      }
+
+      // The remainder of this slab is wasted until the next reset.
+      m_current_slab++;
+      m_slab_used = 0;
+    }
+  }
+
+  /// Makes all objects available for reuse. Previously returned pointers remain valid until they're handed out again.
+  void Reset()
+  {
+    m_current_slab = 0;
+    m_slab_used = 0;
+    m_allocated_count = 0;
+  }
+
+  /// Releases all slabs.
+  void Clear()
+  {
+    m_slabs.clear();
+    Reset();
+  }
+
+  /// Returns the number of objects allocated since the last reset.
+  u32 GetAllocatedCount() const { return m_allocated_count; }
+
+  /// Returns the number of slabs which have been created.
+  u32 GetSlabCount() const { return static_cast<u32>(m_slabs.size()); }
+
+private:
+  struct Slab
+  {
+    std::unique_ptr<T[]> data;
+    u32 size;
+  };
+
+  std::vector<Slab> m_slabs;
+  u32 m_current_slab = 0;
+  u32 m_slab_used = 0;
+  u32 m_allocated_count = 0;
+};
@@ -1,13 +1,16 @@
 #include "bus.h"
+#include "bus_memory_map.h"
 #include "cdrom.h"
 #include "common/align.h"
 #include "common/assert.h"
 #include "common/log.h"
+#include "common/memory_arena.h"
 #include "common/state_wrapper.h"
 #include "cpu_code_cache.h"
 #include "cpu_core.h"
 #include "cpu_core_private.h"
 #include "cpu_disasm.h"
+#include "cpu_recompiler_thunks.h"
 #include "dma.h"
 #include "gpu.h"
 #include "interrupt_controller.h"
@@ -16,7 +19,9 @@
 #include "sio.h"
 #include "spu.h"
 #include "timers.h"
+#include <algorithm>
 #include <cstdio>
+#include <numeric>
 #include <tuple>
 Log_SetChannel(Bus);
 
@@ -68,9 +73,35 @@ union MEMCTRL
   };
 };
 
+enum : u32
+{
+  MEMORY_ARENA_RAM_OFFSET = 0,
+  MEMORY_ARENA_BIOS_OFFSET = MEMORY_ARENA_RAM_OFFSET + RAM_SIZE,
+  MEMORY_ARENA_SIZE = MEMORY_ARENA_BIOS_OFFSET + BIOS_SIZE,
+
+  // Write protection for code pages is done at host page granularity.
+  HOST_PAGE_SIZE = 4096,
+  HOST_PAGE_COUNT = RAM_SIZE / HOST_PAGE_SIZE,
+  CODE_PAGES_PER_HOST_PAGE = HOST_PAGE_SIZE / CPU_CODE_CACHE_PAGE_SIZE,
+};
+
+static constexpr size_t FASTMEM_REGION_SIZE = UINT64_C(0x100000000);
+
 std::bitset<CPU_CODE_CACHE_PAGE_COUNT> m_ram_code_bits{};
-u8 g_ram[RAM_SIZE]{};   // 2MB RAM
-u8 g_bios[BIOS_SIZE]{}; // 512K BIOS ROM
+std::bitset<CPU_CODE_CACHE_RANGE_COUNT> m_ram_code_range_bits{};
+u8* g_ram = nullptr;  // 2MB RAM
+u8* g_bios = nullptr; // 512K BIOS ROM
+
+static Common::MemoryArena m_memory_arena;
+static u8* m_fastmem_base = nullptr;
+static std::vector<Common::MemoryArena::View> m_fastmem_ram_views;
+
+// When code page write protection is enabled, code pages are tracked here instead of m_ram_code_bits, and writes to
+// them are caught by the page fault handler.
+static bool m_code_page_write_protection = false;
+static std::bitset<CPU_CODE_CACHE_PAGE_COUNT> m_ram_protected_code_bits{};
+static std::array<u32, HOST_PAGE_COUNT> m_code_page_write_fault_counts{};
+static u32 m_code_page_write_fault_total = 0;
 
 static std::array<TickCount, 3> m_exp1_access_time = {};
 static std::array<TickCount, 3> m_exp2_access_time = {};
@@ -88,6 +119,11 @@ static std::string m_tty_line_buffer;
 static std::tuple<TickCount, TickCount, TickCount> CalculateMemoryTiming(MEMDELAY mem_delay, COMDELAY common_delay);
 static void RecalculateMemoryTimings();
 
+static bool AllocateMemory();
+static void ReleaseMemory();
+static void SetHostPageProtection(u32 page_index, bool writable);
+static void LogCodePageWriteFaultStatistics();
+
 #define FIXUP_WORD_READ_OFFSET(offset) ((offset) & ~u32(3))
 #define FIXUP_WORD_READ_VALUE(offset, value) ((value) >> (((offset)&u32(3)) * 8u))
 #define FIXUP_HALFWORD_READ_OFFSET(offset) ((offset) & ~u32(1))
@@ -103,19 +139,26 @@ ALWAYS_INLINE static void FixupUnalignedWordAccessW32(u32& offset, u32& value)
   value <<= byte_offset * 8;
 }
 
-void Initialize()
+bool Initialize()
 {
+  if (!AllocateMemory())
+    return false;
+
   Reset();
+  return true;
 }
 
 void Shutdown()
 {
-  //
+  LogCodePageWriteFaultStatistics();
+  UpdateFastmemViews(false, false);
+  ReleaseMemory();
 }
 
 void Reset()
 {
-  std::memset(g_ram, 0, sizeof(g_ram));
+  LogCodePageWriteFaultStatistics();
+  std::memset(g_ram, 0, RAM_SIZE);
   m_MEMCTRL.exp1_base = 0x1F000000;
   m_MEMCTRL.exp2_base = 0x1F802000;
   m_MEMCTRL.exp1_delay_size.bits = 0x0013243F;
@@ -126,7 +169,7 @@ void Reset()
   m_MEMCTRL.exp2_delay_size.bits = 0x00070777;
   m_MEMCTRL.common_delay.bits = 0x00031125;
   m_ram_size_reg = UINT32_C(0x00000B88);
-  m_ram_code_bits = {};
+  ClearRAMCodePageFlags();
   RecalculateMemoryTimings();
 }
 
@@ -137,8 +180,8 @@ bool DoState(StateWrapper& sw)
   sw.Do(&m_bios_access_time);
   sw.Do(&m_cdrom_access_time);
   sw.Do(&m_spu_access_time);
-  sw.DoBytes(g_ram, sizeof(g_ram));
-  sw.DoBytes(g_bios, sizeof(g_bios));
+  sw.DoBytes(g_ram, RAM_SIZE);
+  sw.DoBytes(g_bios, BIOS_SIZE);
   sw.DoArray(m_MEMCTRL.regs, countof(m_MEMCTRL.regs));
   sw.Do(&m_ram_size_reg);
   sw.Do(&m_tty_line_buffer);
@@ -161,6 +204,276 @@ void SetBIOS(const std::vector<u8>& image)
   std::memcpy(g_bios, image.data(), BIOS_SIZE);
 }
 
+bool AllocateMemory()
+{
+  if (!m_memory_arena.Create(MEMORY_ARENA_SIZE, true, false))
+  {
+    Log_ErrorPrint("Failed to create memory arena");
+    return false;
+  }
+
+  // Create the base views.
+  g_ram = static_cast<u8*>(m_memory_arena.CreateViewPtr(MEMORY_ARENA_RAM_OFFSET, RAM_SIZE, true, false));
+  g_bios = static_cast<u8*>(m_memory_arena.CreateViewPtr(MEMORY_ARENA_BIOS_OFFSET, BIOS_SIZE, true, false));
+  if (!g_ram || !g_bios)
+  {
+    Log_ErrorPrint("Failed to create RAM/BIOS views");
+    ReleaseMemory();
+    return false;
+  }
+
+  return true;
+}
+
+void ReleaseMemory()
+{
+  if (g_ram)
+  {
+    m_memory_arena.ReleaseViewPtr(g_ram, RAM_SIZE, false);
+    g_ram = nullptr;
+  }
+
+  if (g_bios)
+  {
+    m_memory_arena.ReleaseViewPtr(g_bios, BIOS_SIZE, false);
+    g_bios = nullptr;
+  }
+
+  m_memory_arena.Destroy();
+}
+
+u8* UpdateFastmemViews(bool enabled, bool isolate_cache)
+{
+  m_fastmem_ram_views.clear();
+  if (!enabled || !m_memory_arena.IsValid())
+  {
+    if (m_fastmem_base)
+    {
+      Common::MemoryArena::ReleaseAddressSpace(m_fastmem_base, FASTMEM_REGION_SIZE);
+      m_fastmem_base = nullptr;
+    }
+
+    return nullptr;
+  }
+
+  if (!m_fastmem_base)
+  {
+    m_fastmem_base = static_cast<u8*>(Common::MemoryArena::ReserveAddressSpace(FASTMEM_REGION_SIZE));
+    if (!m_fastmem_base)
+    {
+      Log_ErrorPrint("Failed to reserve address space for fastmem");
+      return nullptr;
+    }
+
+    Log_InfoPrintf("Fastmem base: %p", m_fastmem_base);
+  }
+
+  auto MapRAM = [](u32 base_address, bool writable) {
+    for (u32 mirror_address = base_address; mirror_address < (base_address + RAM_MIRROR_END);
+         mirror_address += RAM_SIZE)
+    {
+      std::optional<Common::MemoryArena::View> view = m_memory_arena.CreateView(
+        MEMORY_ARENA_RAM_OFFSET, RAM_SIZE, writable, false, m_fastmem_base + mirror_address);
+      if (!view)
+      {
+        Log_ErrorPrintf("Failed to map RAM at fastmem address 0x%08X", mirror_address);
+        continue;
+      }
+
+      m_fastmem_ram_views.push_back(std::move(view.value()));
+    }
+  };
+
+  // Scratchpad and BIOS are left unmapped, accesses there fault and are backpatched to the slow path.
+  m_fastmem_ram_views.reserve((RAM_MIRROR_END / RAM_SIZE) * 3);
+  MapRAM(0x00000000, !isolate_cache); // KUSEG
+  MapRAM(0x80000000, !isolate_cache); // KSEG0
+  MapRAM(0xA0000000, true);           // KSEG1
+
+  // Code pages need to stay write protected, so that the code cache is notified of changes.
+  for (u32 i = 0; i < CPU_CODE_CACHE_PAGE_COUNT; i++)
+  {
+    if (m_ram_code_bits[i] || m_ram_protected_code_bits[i])
+      SetHostPageProtection(i, false);
+  }
+
+  return m_fastmem_base;
+}
+
+bool IsFastmemAddress(const void* host_address)
+{
+  const u8* ptr = static_cast<const u8*>(host_address);
+  return (m_fastmem_base && ptr >= m_fastmem_base && ptr < (m_fastmem_base + FASTMEM_REGION_SIZE));
+}
+
+void SetHostPageProtection(u32 page_index, bool writable)
+{
+  // Only unprotect the host page once no code pages within it remain.
+  const u32 first_page_index = page_index & ~(CODE_PAGES_PER_HOST_PAGE - 1);
+  if (writable)
+  {
+    for (u32 i = 0; i < CODE_PAGES_PER_HOST_PAGE; i++)
+    {
+      if (m_ram_code_bits[first_page_index + i] || m_ram_protected_code_bits[first_page_index + i])
+        return;
+    }
+  }
+
+  const u32 offset = first_page_index * CPU_CODE_CACHE_PAGE_SIZE;
+  if (m_code_page_write_protection &&
+      !Common::MemoryArena::SetPageProtection(g_ram + offset, HOST_PAGE_SIZE, true, writable, false))
+  {
+    Log_ErrorPrintf("Failed to change protection of RAM page %p", g_ram + offset);
+  }
+
+  for (const Common::MemoryArena::View& view : m_fastmem_ram_views)
+  {
+    if (!view.IsWritable())
+      continue;
+
+    u8* host_address = static_cast<u8*>(view.GetBasePointer()) + offset;
+    if (!Common::MemoryArena::SetPageProtection(host_address, HOST_PAGE_SIZE, true, writable, false))
+      Log_ErrorPrintf("Failed to change protection of fastmem page %p", host_address);
+  }
+}
+
+void SetCodePageWriteProtection(bool enabled)
+{
+  if (m_code_page_write_protection == enabled)
+    return;
+
+  // Code pages are tracked separately in each mode, the code cache is flushed when this changes.
+  ClearRAMCodePageFlags();
+  m_code_page_write_protection = enabled;
+  Log_InfoPrintf("Code page write protection is %s", enabled ? "enabled" : "disabled");
+}
+
+bool HandleCodePageWriteFault(const void* host_address)
+{
+  if (!m_code_page_write_protection)
+    return false;
+
+  // Work out which RAM page is being written, either directly or through a fastmem mirror.
+  const u8* ptr = static_cast<const u8*>(host_address);
+  u32 offset;
+  if (g_ram && ptr >= g_ram && ptr < (g_ram + RAM_SIZE))
+  {
+    offset = static_cast<u32>(ptr - g_ram);
+  }
+  else if (IsFastmemAddress(ptr))
+  {
+    const u32 address = static_cast<u32>(ptr - m_fastmem_base);
+    const u32 segment = address >> 29;
+    if ((segment != 0x00 && segment != 0x04 && segment != 0x05) ||
+        !IsRAMAddress(address & CPU::PHYSICAL_MEMORY_ADDRESS_MASK))
+    {
+      return false;
+    }
+
+    offset = address & RAM_MASK;
+  }
+  else
+  {
+    return false;
+  }
+
+  const u32 host_page_index = offset / HOST_PAGE_SIZE;
+  const u32 first_page_index = host_page_index * CODE_PAGES_PER_HOST_PAGE;
+  bool had_code = false;
+  for (u32 i = 0; i < CODE_PAGES_PER_HOST_PAGE; i++)
+  {
+    // Invalidating clears the code page, which unprotects the host page once they're all gone.
+    if (m_ram_protected_code_bits[first_page_index + i])
+    {
+      CPU::CodeCache::InvalidateBlocksWithPageIndex(first_page_index + i);
+      had_code = true;
+    }
+  }
+  if (!had_code)
+    return false;
+
+  Log_DevPrintf("Write to protected code page at RAM offset 0x%08X", offset);
+  m_code_page_write_fault_counts[host_page_index]++;
+  m_code_page_write_fault_total++;
+  return true;
+}
+
+void LogCodePageWriteFaultStatistics()
+{
+  if (m_code_page_write_fault_total == 0)
+    return;
+
+  Log_InfoPrintf("%u writes to protected code pages", m_code_page_write_fault_total);
+
+  // Show the pages which flip the most, these are the ones which thrash.
+  constexpr u32 NUM_PAGES_TO_LOG = 8;
+  std::array<u32, HOST_PAGE_COUNT> order;
+  std::iota(order.begin(), order.end(), 0u);
+  std::partial_sort(order.begin(), order.begin() + NUM_PAGES_TO_LOG, order.end(), [](u32 lhs, u32 rhs) {
+    return m_code_page_write_fault_counts[lhs] > m_code_page_write_fault_counts[rhs];
+  });
+  for (u32 i = 0; i < NUM_PAGES_TO_LOG && m_code_page_write_fault_counts[order[i]] > 0; i++)
+  {
+    Log_InfoPrintf("  RAM 0x%08X-0x%08X: %u writes", order[i] * HOST_PAGE_SIZE,
+                   (order[i] + 1) * HOST_PAGE_SIZE - 1, m_code_page_write_fault_counts[order[i]]);
+  }
+
+  m_code_page_write_fault_counts.fill(0);
+  m_code_page_write_fault_total = 0;
+}
+
+void SetRAMCodePage(u32 index)
+{
+  // With write protection, stores don't need to check the code bits, the page fault handler catches them instead.
+  auto& code_bits = m_code_page_write_protection ? m_ram_protected_code_bits : m_ram_code_bits;
+  if (code_bits[index])
+    return;
+
+  code_bits[index] = true;
+  if (m_code_page_write_protection || m_fastmem_base)
+    SetHostPageProtection(index, false);
+}
+
+void SetRAMCodeRange(PhysicalMemoryAddress address)
+{
+  // Write protection works at host page granularity, so the ranges aren't used.
+  if (!m_code_page_write_protection)
+    m_ram_code_range_bits[(address & RAM_MASK) / CPU_CODE_CACHE_RANGE_SIZE] = true;
+}
+
+void ClearRAMCodePage(u32 index)
+{
+  auto& code_bits = m_code_page_write_protection ? m_ram_protected_code_bits : m_ram_code_bits;
+  if (!code_bits[index])
+    return;
+
+  code_bits[index] = false;
+  if (!m_code_page_write_protection)
+  {
+    for (u32 i = 0; i < CPU_CODE_CACHE_RANGES_PER_PAGE; i++)
+      m_ram_code_range_bits[index * CPU_CODE_CACHE_RANGES_PER_PAGE + i] = false;
+  }
+
+  if (m_code_page_write_protection || m_fastmem_base)
+    SetHostPageProtection(index, true);
+}
+
+void ClearRAMCodePageFlags()
+{
+  m_ram_code_bits.reset();
+  m_ram_code_range_bits.reset();
+  m_ram_protected_code_bits.reset();
+
+  if (m_code_page_write_protection && g_ram)
+    Common::MemoryArena::SetPageProtection(g_ram, RAM_SIZE, true, true, false);
+
+  for (const Common::MemoryArena::View& view : m_fastmem_ram_views)
+  {
+    if (view.IsWritable())
+      Common::MemoryArena::SetPageProtection(view.GetBasePointer(), view.GetMappingSize(), true, true, false);
+  }
+}
+
 std::tuple<TickCount, TickCount, TickCount> CalculateMemoryTiming(MEMDELAY mem_delay, COMDELAY common_delay)
 {
   // from nocash spec
@@ -269,9 +582,9 @@ ALWAYS_INLINE static TickCount DoRAMAccess(u32 offset, u32& value)
   }
   else
   {
-    const u32 page_index = offset / CPU_CODE_CACHE_PAGE_SIZE;
-    if (m_ram_code_bits[page_index])
-      CPU::CodeCache::InvalidateBlocksWithPageIndex(page_index);
+    // Data which shares a page with code doesn't invalidate it, unless it's right next to the code.
+    if (m_ram_code_range_bits[offset / CPU_CODE_CACHE_RANGE_SIZE])
+      CPU::CodeCache::InvalidateBlocksWithPageIndex(offset / CPU_CODE_CACHE_PAGE_SIZE);
 
     if constexpr (size == MemoryAccessSize::Byte)
     {
@@ -288,7 +601,7 @@ ALWAYS_INLINE static TickCount DoRAMAccess(u32 offset, u32& value)
     }
   }
 
-  return (type == MemoryAccessType::Read) ? 4 : 0;
+  return (type == MemoryAccessType::Read) ? RAM_READ_TICKS : 0;
 }
 
 template<MemoryAccessType type, MemoryAccessSize size>
@@ -738,6 +1051,63 @@ ALWAYS_INLINE static TickCount DoDMAAccess(u32 offset, u32& value)
   }
 }
 
+/// Dispatches an access to a physical address through the memory map. The switch becomes a jump table, so there's one
+/// indexed load and one indirect branch whatever the region, instead of a compare for each region below it.
+template<MemoryAccessType type, MemoryAccessSize size>
+ALWAYS_INLINE static TickCount DoMappedAccess(PhysicalMemoryAddress address, u32& value)
+{
+  switch (GetMappedMemoryRegion(address))
+  {
+    case MemoryRegion::RAM:
+      return DoRAMAccess<type, size>(address & RAM_MASK, value);
+
+    case MemoryRegion::EXP1:
+      return DoEXP1Access<type, size>(address & EXP1_MASK, value);
+
+    case MemoryRegion::MemoryControl:
+      return DoMemoryControlAccess<type, size>(address & MEMCTRL_MASK, value);
+
+    case MemoryRegion::Pad:
+      return DoPadAccess<type, size>(address & PAD_MASK, value);
+
+    case MemoryRegion::SIO:
+      return DoSIOAccess<type, size>(address & SIO_MASK, value);
+
+    case MemoryRegion::MemoryControl2:
+      return DoMemoryControl2Access<type, size>(address & MEMCTRL2_MASK, value);
+
+    case MemoryRegion::InterruptController:
+      return DoAccessInterruptController<type, size>(address & INTERRUPT_CONTROLLER_MASK, value);
+
+    case MemoryRegion::DMA:
+      return DoDMAAccess<type, size>(address & DMA_MASK, value);
+
+    case MemoryRegion::Timers:
+      return DoAccessTimers<type, size>(address & TIMERS_MASK, value);
+
+    case MemoryRegion::CDROM:
+      return DoCDROMAccess<type, size>(address & CDROM_MASK, value);
+
+    case MemoryRegion::GPU:
+      return DoGPUAccess<type, size>(address & GPU_MASK, value);
+
+    case MemoryRegion::MDEC:
+      return DoMDECAccess<type, size>(address & MDEC_MASK, value);
+
+    case MemoryRegion::SPU:
+      return DoAccessSPU<type, size>(address & SPU_MASK, value);
+
+    case MemoryRegion::EXP2:
+      return DoEXP2Access<type, size>(address & EXP2_MASK, value);
+
+    case MemoryRegion::BIOS:
+      return DoBIOSAccess<type, size>(address & BIOS_MASK, value);
+
+    default:
+      return DoInvalidAccess(type, size, address, value);
+  }
+}
+
 } // namespace Bus
 
 namespace CPU {
@@ -845,94 +1215,11 @@ static ALWAYS_INLINE TickCount DoMemoryAccess(VirtualMemoryAddress address, u32&
     }
   }
 
+  // RAM is by far the most common, so it skips the memory map.
   if (address < 0x800000)
-  {
     return DoRAMAccess<type, size>(address, value);
-  }
-  else if (address < EXP1_BASE)
-  {
-    return DoInvalidAccess(type, size, address, value);
-  }
-  else if (address < (EXP1_BASE + EXP1_SIZE))
-  {
-    return DoEXP1Access<type, size>(address & EXP1_MASK, value);
-  }
-  else if (address < MEMCTRL_BASE)
-  {
-    return DoInvalidAccess(type, size, address, value);
-  }
-  else if (address < (MEMCTRL_BASE + MEMCTRL_SIZE))
-  {
-    return DoMemoryControlAccess<type, size>(address & MEMCTRL_MASK, value);
-  }
-  else if (address < (PAD_BASE + PAD_SIZE))
-  {
-    return DoPadAccess<type, size>(address & PAD_MASK, value);
-  }
-  else if (address < (SIO_BASE + SIO_SIZE))
-  {
-    return DoSIOAccess<type, size>(address & SIO_MASK, value);
-  }
-  else if (address < (MEMCTRL2_BASE + MEMCTRL2_SIZE))
-  {
-    return DoMemoryControl2Access<type, size>(address & MEMCTRL2_MASK, value);
-  }
-  else if (address < (INTERRUPT_CONTROLLER_BASE + INTERRUPT_CONTROLLER_SIZE))
-  {
-    return DoAccessInterruptController<type, size>(address & INTERRUPT_CONTROLLER_MASK, value);
-  }
-  else if (address < (DMA_BASE + DMA_SIZE))
-  {
-    return DoDMAAccess<type, size>(address & DMA_MASK, value);
-  }
-  else if (address < (TIMERS_BASE + TIMERS_SIZE))
-  {
-    return DoAccessTimers<type, size>(address & TIMERS_MASK, value);
-  }
-  else if (address < CDROM_BASE)
-  {
-    return DoInvalidAccess(type, size, address, value);
-  }
-  else if (address < (CDROM_BASE + GPU_SIZE))
-  {
-    return DoCDROMAccess<type, size>(address & CDROM_MASK, value);
-  }
-  else if (address < (GPU_BASE + GPU_SIZE))
-  {
-    return DoGPUAccess<type, size>(address & GPU_MASK, value);
-  }
-  else if (address < (MDEC_BASE + MDEC_SIZE))
-  {
-    return DoMDECAccess<type, size>(address & MDEC_MASK, value);
-  }
-  else if (address < SPU_BASE)
-  {
-    return DoInvalidAccess(type, size, address, value);
-  }
-  else if (address < (SPU_BASE + SPU_SIZE))
-  {
-    return DoAccessSPU<type, size>(address & SPU_MASK, value);
-  }
-  else if (address < EXP2_BASE)
-  {
-    return DoInvalidAccess(type, size, address, value);
-  }
-  else if (address < (EXP2_BASE + EXP2_SIZE))
-  {
-    return DoEXP2Access<type, size>(address & EXP2_MASK, value);
-  }
-  else if (address < BIOS_BASE)
-  {
-    return DoInvalidAccess(type, size, address, value);
-  }
-  else if (address < (BIOS_BASE + BIOS_SIZE))
-  {
-    return DoBIOSAccess<type, size>(static_cast<u32>(address - BIOS_BASE), value);
-  }
-  else
-  {
-    return DoInvalidAccess(type, size, address, value);
-  }
+
+  return DoMappedAccess<type, size>(address, value);
 }
 
 template<MemoryAccessType type, MemoryAccessSize size>
@@ -1237,6 +1524,141 @@ void UncheckedWriteMemoryWord(u32 address, u32 value)
   g_state.pending_ticks += DoMemoryAccess<MemoryAccessType::Write, MemoryAccessSize::Word>(address, value);
 }
 
+template<MemoryAccessSize size, TickCount (*Access)(u32, u32&), u32 mask>
+static u32 DirectReadMemory(u32 address)
+{
+  u32 value;
+  g_state.pending_ticks += Access(address & mask, value);
+  return value;
+}
+
+template<MemoryAccessSize size, TickCount (*Access)(u32, u32&), u32 mask, bool check_isc>
+static void DirectWriteMemory(u32 address, u32 value)
+{
+  if constexpr (check_isc)
+  {
+    if (g_state.cop0_regs.sr.Isc)
+      return;
+  }
+
+  // The upper bits aren't guaranteed to be zero for narrow stores.
+  if constexpr (size == MemoryAccessSize::Byte)
+    value = ZeroExtend32(Truncate8(value));
+  else if constexpr (size == MemoryAccessSize::HalfWord)
+    value = ZeroExtend32(Truncate16(value));
+
+  g_state.pending_ticks += Access(address & mask, value);
+}
+
+template<MemoryAccessType type, MemoryAccessSize size, TickCount (*Access)(u32, u32&), u32 mask, bool cached>
+static const void* MakeDirectAccessThunk()
+{
+  if constexpr (type == MemoryAccessType::Read)
+    return reinterpret_cast<const void*>(&DirectReadMemory<size, Access, mask>);
+  else
+    return reinterpret_cast<const void*>(&DirectWriteMemory<size, Access, mask, cached>);
+}
+
+/// Mirrors the decoding in DoMemoryAccess() for a constant address, returning nullptr if the access can't be made
+/// directly. Accesses through the cached segments have to check for cache isolation and the scratchpad.
+template<MemoryAccessType type, MemoryAccessSize size, bool cached>
+static const void* GetDirectAccessThunkForRegion(PhysicalMemoryAddress address)
+{
+  using namespace Bus;
+
+  if (cached && (address & DCACHE_LOCATION_MASK) == DCACHE_LOCATION)
+  {
+    return MakeDirectAccessThunk<type, size, &DoScratchpadAccess<type, size>, PHYSICAL_MEMORY_ADDRESS_MASK,
+                                 cached>();
+  }
+  else if (address < 0x800000)
+    return MakeDirectAccessThunk<type, size, &DoRAMAccess<type, size>, RAM_MASK, cached>();
+  else if (address >= MEMCTRL_BASE && address < (MEMCTRL_BASE + MEMCTRL_SIZE))
+    return MakeDirectAccessThunk<type, size, &DoMemoryControlAccess<type, size>, MEMCTRL_MASK, cached>();
+  else if (address >= PAD_BASE && address < (PAD_BASE + PAD_SIZE))
+    return MakeDirectAccessThunk<type, size, &DoPadAccess<type, size>, PAD_MASK, cached>();
+  else if (address >= SIO_BASE && address < (SIO_BASE + SIO_SIZE))
+    return MakeDirectAccessThunk<type, size, &DoSIOAccess<type, size>, SIO_MASK, cached>();
+  else if (address >= MEMCTRL2_BASE && address < (MEMCTRL2_BASE + MEMCTRL2_SIZE))
+    return MakeDirectAccessThunk<type, size, &DoMemoryControl2Access<type, size>, MEMCTRL2_MASK, cached>();
+  else if (address >= INTERRUPT_CONTROLLER_BASE && address < (INTERRUPT_CONTROLLER_BASE + INTERRUPT_CONTROLLER_SIZE))
+  {
+    return MakeDirectAccessThunk<type, size, &DoAccessInterruptController<type, size>, INTERRUPT_CONTROLLER_MASK,
+                                 cached>();
+  }
+  else if (address >= DMA_BASE && address < (DMA_BASE + DMA_SIZE))
+    return MakeDirectAccessThunk<type, size, &DoDMAAccess<type, size>, DMA_MASK, cached>();
+  else if (address >= TIMERS_BASE && address < (TIMERS_BASE + TIMERS_SIZE))
+    return MakeDirectAccessThunk<type, size, &DoAccessTimers<type, size>, TIMERS_MASK, cached>();
+  else if (address >= CDROM_BASE && address < (CDROM_BASE + CDROM_SIZE))
+    return MakeDirectAccessThunk<type, size, &DoCDROMAccess<type, size>, CDROM_MASK, cached>();
+  else if (address >= GPU_BASE && address < (GPU_BASE + GPU_SIZE))
+    return MakeDirectAccessThunk<type, size, &DoGPUAccess<type, size>, GPU_MASK, cached>();
+  else if (address >= MDEC_BASE && address < (MDEC_BASE + MDEC_SIZE))
+    return MakeDirectAccessThunk<type, size, &DoMDECAccess<type, size>, MDEC_MASK, cached>();
+  else if (address >= SPU_BASE && address < (SPU_BASE + SPU_SIZE))
+    return MakeDirectAccessThunk<type, size, &DoAccessSPU<type, size>, SPU_MASK, cached>();
+  else
+    return nullptr;
+}
+
+template<MemoryAccessType type, MemoryAccessSize size>
+static const void* GetDirectAccessThunk(VirtualMemoryAddress address)
+{
+  switch (address >> 29)
+  {
+    case 0x00: // KUSEG 0M-512M
+    case 0x04: // KSEG0 - physical memory cached
+      return GetDirectAccessThunkForRegion<type, size, true>(address & PHYSICAL_MEMORY_ADDRESS_MASK);
+
+    case 0x05: // KSEG1 - physical memory uncached
+      return GetDirectAccessThunkForRegion<type, size, false>(address & PHYSICAL_MEMORY_ADDRESS_MASK);
+
+    default:
+      return nullptr;
+  }
+}
+
+UncheckedReadMemoryHandler GetUncheckedReadMemoryHandler(u32 address, MemoryAccessSize size)
+{
+  const void* thunk;
+  switch (size)
+  {
+    case MemoryAccessSize::Byte:
+      thunk = GetDirectAccessThunk<MemoryAccessType::Read, MemoryAccessSize::Byte>(address);
+      break;
+    case MemoryAccessSize::HalfWord:
+      thunk = GetDirectAccessThunk<MemoryAccessType::Read, MemoryAccessSize::HalfWord>(address);
+      break;
+    case MemoryAccessSize::Word:
+    default:
+      thunk = GetDirectAccessThunk<MemoryAccessType::Read, MemoryAccessSize::Word>(address);
+      break;
+  }
+
+  return reinterpret_cast<UncheckedReadMemoryHandler>(thunk);
+}
+
+UncheckedWriteMemoryHandler GetUncheckedWriteMemoryHandler(u32 address, MemoryAccessSize size)
+{
+  const void* thunk;
+  switch (size)
+  {
+    case MemoryAccessSize::Byte:
+      thunk = GetDirectAccessThunk<MemoryAccessType::Write, MemoryAccessSize::Byte>(address);
+      break;
+    case MemoryAccessSize::HalfWord:
+      thunk = GetDirectAccessThunk<MemoryAccessType::Write, MemoryAccessSize::HalfWord>(address);
+      break;
+    case MemoryAccessSize::Word:
+    default:
+      thunk = GetDirectAccessThunk<MemoryAccessType::Write, MemoryAccessSize::Word>(address);
+      break;
+  }
+
+  return reinterpret_cast<UncheckedWriteMemoryHandler>(thunk);
+}
+
 } // namespace Recompiler::Thunks
 
 } // namespace CPU
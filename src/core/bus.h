@@ -2,6 +2,7 @@
 #include "common/bitfield.h"
 #include "cpu_code_cache.h"
 #include "types.h"
+#include <algorithm>
 #include <array>
 #include <bitset>
 #include <string>
@@ -66,7 +67,12 @@ enum : u32
   MEMCTRL_REG_COUNT = 9
 };
 
-void Initialize();
+enum : TickCount
+{
+  RAM_READ_TICKS = 4
+};
+
+bool Initialize();
 void Shutdown();
 void Reset();
 bool DoState(StateWrapper& sw);
@@ -74,9 +80,25 @@ bool DoState(StateWrapper& sw);
 void SetExpansionROM(std::vector<u8> data);
 void SetBIOS(const std::vector<u8>& image);
 
+/// Creates or destroys the fastmem views of RAM, returning the base of the guest address space mapping.
+/// When the cache is isolated, stores to KUSEG/KSEG0 are dropped, so those views are mapped read-only.
+u8* UpdateFastmemViews(bool enabled, bool isolate_cache);
+
+/// Returns true if the host address is within the fastmem region.
+bool IsFastmemAddress(const void* host_address);
+
+/// Switches between write-protecting RAM code pages and checking the code bits on every store.
+/// All code pages are cleared, so the code cache must be flushed.
+void SetCodePageWriteProtection(bool enabled);
+
+/// Invalidates and unprotects the code page containing a faulting write to RAM or its fastmem mirrors.
+/// Returns false if the address is not in a write-protected code page.
+bool HandleCodePageWriteFault(const void* host_address);
+
 extern std::bitset<CPU_CODE_CACHE_PAGE_COUNT> m_ram_code_bits;
-extern u8 g_ram[RAM_SIZE];   // 2MB RAM
-extern u8 g_bios[BIOS_SIZE]; // 512K BIOS ROM
+extern std::bitset<CPU_CODE_CACHE_RANGE_COUNT> m_ram_code_range_bits;
+extern u8* g_ram;  // 2MB RAM
+extern u8* g_bios; // 512K BIOS ROM
 
 /// Returns the address which should be used for code caching (i.e. removes mirrors).
 ALWAYS_INLINE PhysicalMemoryAddress UnmirrorAddress(PhysicalMemoryAddress address)
@@ -114,13 +136,17 @@ ALWAYS_INLINE u32 ReadCacheableAddress(PhysicalMemoryAddress address)
 ALWAYS_INLINE bool IsRAMAddress(PhysicalMemoryAddress address) { return address < RAM_MIRROR_END; }
 
 /// Flags a RAM region as code, so we know when to invalidate blocks.
-ALWAYS_INLINE void SetRAMCodePage(u32 index) { m_ram_code_bits[index] = true; }
+void SetRAMCodePage(u32 index);
+
+/// Flags the range containing the RAM address as code. Stores to the rest of the page won't invalidate it.
+/// The page must have already been flagged with SetRAMCodePage().
+void SetRAMCodeRange(PhysicalMemoryAddress address);
 
 /// Unflags a RAM region as code, the code cache will no longer be notified when writes occur.
-ALWAYS_INLINE void ClearRAMCodePage(u32 index) { m_ram_code_bits[index] = false; }
+void ClearRAMCodePage(u32 index);
 
 /// Clears all code bits for RAM regions.
-ALWAYS_INLINE void ClearRAMCodePageFlags() { m_ram_code_bits.reset(); }
+void ClearRAMCodePageFlags();
 
 /// Returns the number of cycles stolen by DMA RAM access.
 ALWAYS_INLINE TickCount GetDMARAMTickCount(u32 word_count)
@@ -132,15 +158,17 @@ ALWAYS_INLINE TickCount GetDMARAMTickCount(u32 word_count)
   return static_cast<TickCount>(word_count + ((word_count + 15) / 16));
 }
 
-/// Invalidates any code pages which overlap the specified range.
+/// Invalidates any code pages with code in the specified range.
 ALWAYS_INLINE void InvalidateCodePages(PhysicalMemoryAddress address, u32 word_count)
 {
-  const u32 start_page = address / CPU_CODE_CACHE_PAGE_SIZE;
-  const u32 end_page = (address + word_count * sizeof(u32)) / CPU_CODE_CACHE_PAGE_SIZE;
-  for (u32 page = start_page; page <= end_page; page++)
+  const u32 start_range = address / CPU_CODE_CACHE_RANGE_SIZE;
+  const u32 end_range = std::min<u32>((address + word_count * sizeof(u32)) / CPU_CODE_CACHE_RANGE_SIZE,
+                                      CPU_CODE_CACHE_RANGE_COUNT - 1);
+  for (u32 range = start_range; range <= end_range; range++)
   {
-    if (m_ram_code_bits[page])
-      CPU::CodeCache::InvalidateBlocksWithPageIndex(page);
+    // Invalidating clears the rest of the page's ranges too.
+    if (m_ram_code_range_bits[range])
+      CPU::CodeCache::InvalidateBlocksWithPageIndex(range / CPU_CODE_CACHE_RANGES_PER_PAGE);
   }
 }
 
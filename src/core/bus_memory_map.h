@@ -0,0 +1,117 @@
+#pragma once
+#include "bus.h"
+#include "cpu_types.h"
+#include "types.h"
+#include <array>
+
+namespace Bus {
+
+/// Physical memory regions, which each have their own access handler.
+enum class MemoryRegion : u8
+{
+  Invalid,
+  RAM,
+  EXP1,
+  MemoryControl,
+  Pad,
+  SIO,
+  MemoryControl2,
+  InterruptController,
+  DMA,
+  Timers,
+  CDROM,
+  GPU,
+  MDEC,
+  SPU,
+  EXP2,
+  BIOS,
+  IOPage // look up the region in the I/O page map instead
+};
+
+static constexpr u32 MEMORY_MAP_PAGE_SHIFT = 16;
+static constexpr u32 MEMORY_MAP_PAGE_COUNT = (CPU::PHYSICAL_MEMORY_ADDRESS_MASK + 1) >> MEMORY_MAP_PAGE_SHIFT;
+static constexpr u32 IO_PAGE_BASE = 0x1F800000;
+static constexpr u32 IO_PAGE_MASK = (1u << MEMORY_MAP_PAGE_SHIFT) - 1;
+static constexpr u32 IO_MAP_GRANULE_SHIFT = 4;
+static constexpr u32 IO_MAP_ENTRY_COUNT = (IO_PAGE_MASK + 1) >> IO_MAP_GRANULE_SHIFT;
+
+/// Returns the region for a physical address. Gaps between I/O registers belong to the next region up, since that's
+/// how the accesses have always been decoded.
+static constexpr MemoryRegion GetMemoryRegion(PhysicalMemoryAddress address)
+{
+  if (address < 0x800000)
+    return MemoryRegion::RAM;
+  else if (address < EXP1_BASE)
+    return MemoryRegion::Invalid;
+  else if (address < (EXP1_BASE + EXP1_SIZE))
+    return MemoryRegion::EXP1;
+  else if (address < MEMCTRL_BASE)
+    return MemoryRegion::Invalid;
+  else if (address < (MEMCTRL_BASE + MEMCTRL_SIZE))
+    return MemoryRegion::MemoryControl;
+  else if (address < (PAD_BASE + PAD_SIZE))
+    return MemoryRegion::Pad;
+  else if (address < (SIO_BASE + SIO_SIZE))
+    return MemoryRegion::SIO;
+  else if (address < (MEMCTRL2_BASE + MEMCTRL2_SIZE))
+    return MemoryRegion::MemoryControl2;
+  else if (address < (INTERRUPT_CONTROLLER_BASE + INTERRUPT_CONTROLLER_SIZE))
+    return MemoryRegion::InterruptController;
+  else if (address < (DMA_BASE + DMA_SIZE))
+    return MemoryRegion::DMA;
+  else if (address < (TIMERS_BASE + TIMERS_SIZE))
+    return MemoryRegion::Timers;
+  else if (address < CDROM_BASE)
+    return MemoryRegion::Invalid;
+  else if (address < (CDROM_BASE + CDROM_SIZE))
+    return MemoryRegion::CDROM;
+  else if (address < (GPU_BASE + GPU_SIZE))
+    return MemoryRegion::GPU;
+  else if (address < (MDEC_BASE + MDEC_SIZE))
+    return MemoryRegion::MDEC;
+  else if (address < SPU_BASE)
+    return MemoryRegion::Invalid;
+  else if (address < (SPU_BASE + SPU_SIZE))
+    return MemoryRegion::SPU;
+  else if (address < EXP2_BASE)
+    return MemoryRegion::Invalid;
+  else if (address < (EXP2_BASE + EXP2_SIZE))
+    return MemoryRegion::EXP2;
+  else if (address < BIOS_BASE)
+    return MemoryRegion::Invalid;
+  else if (address < (BIOS_BASE + BIOS_SIZE))
+    return MemoryRegion::BIOS;
+  else
+    return MemoryRegion::Invalid;
+}
+
+/// Region for each 64KB page of physical memory. The I/O registers share a page, so it has its own finer map.
+static constexpr std::array<MemoryRegion, MEMORY_MAP_PAGE_COUNT> s_memory_map = []() {
+  std::array<MemoryRegion, MEMORY_MAP_PAGE_COUNT> map = {};
+  for (u32 i = 0; i < MEMORY_MAP_PAGE_COUNT; i++)
+  {
+    const u32 address = i << MEMORY_MAP_PAGE_SHIFT;
+    map[i] = (address == IO_PAGE_BASE) ? MemoryRegion::IOPage : GetMemoryRegion(address);
+  }
+  return map;
+}();
+
+/// Region for each 16 byte granule of the I/O page, which is the smallest register block.
+static constexpr std::array<MemoryRegion, IO_MAP_ENTRY_COUNT> s_io_memory_map = []() {
+  std::array<MemoryRegion, IO_MAP_ENTRY_COUNT> map = {};
+  for (u32 i = 0; i < IO_MAP_ENTRY_COUNT; i++)
+    map[i] = GetMemoryRegion(IO_PAGE_BASE + (i << IO_MAP_GRANULE_SHIFT));
+  return map;
+}();
+
+/// Returns the region for a physical address, using the memory map.
+ALWAYS_INLINE static MemoryRegion GetMappedMemoryRegion(PhysicalMemoryAddress address)
+{
+  const MemoryRegion region = s_memory_map[address >> MEMORY_MAP_PAGE_SHIFT];
+  if (region != MemoryRegion::IOPage)
+    return region;
+
+  return s_io_memory_map[(address & IO_PAGE_MASK) >> IO_MAP_GRANULE_SHIFT];
+}
+
+} // namespace Bus
@@ -1,16 +1,31 @@
 #include "cpu_code_cache.h"
 #include "bus.h"
 #include "common/assert.h"
+#include "common/file_system.h"
 #include "common/log.h"
+#include "common/page_fault_handler.h"
+#include "common/slab_allocator.h"
+#include "common/timer.h"
 #include "cpu_core.h"
 #include "cpu_core_private.h"
 #include "cpu_disasm.h"
+#include "host_interface.h"
+#include "settings.h"
 #include "system.h"
 #include "timing_event.h"
+#include "xxhash.h"
+#include <algorithm>
+#include <array>
+#include <cstring>
+#include <imgui.h>
+#include <map>
+#include <unordered_map>
 Log_SetChannel(CPU::CodeCache);
 
 #ifdef WITH_RECOMPILER
 #include "cpu_recompiler_code_generator.h"
+#include "cpu_recompiler_disk_cache.h"
+#include "cpu_recompiler_thread.h"
 #endif
 
 namespace CPU::CodeCache {
@@ -18,12 +33,28 @@ namespace CPU::CodeCache {
 constexpr bool USE_BLOCK_LINKING = true;
 
 #ifdef WITH_RECOMPILER
-static constexpr u32 RECOMPILER_CODE_CACHE_SIZE = 32 * 1024 * 1024;
-static constexpr u32 RECOMPILER_FAR_CODE_CACHE_SIZE = 32 * 1024 * 1024;
+// The code cache size setting picks how much of the storage is used, including the far code.
+static constexpr u32 RECOMPILER_MIN_CODE_CACHE_SIZE_MB = 8;
+static constexpr u32 RECOMPILER_MAX_CODE_CACHE_SIZE_MB = 128;
 static constexpr u32 RECOMPILER_GUARD_SIZE = 4096;
 alignas(Recompiler::CODE_STORAGE_ALIGNMENT) static u8
-  s_code_storage[RECOMPILER_CODE_CACHE_SIZE + RECOMPILER_FAR_CODE_CACHE_SIZE];
-static JitCodeBuffer s_code_buffer;
+  s_code_storage[RECOMPILER_MAX_CODE_CACHE_SIZE_MB * 1024 * 1024];
+
+// The storage is split into segments which are filled in turn. When the current segment is full, only the blocks in
+// the oldest segment are thrown away, instead of flushing the whole cache.
+static constexpr u32 RECOMPILER_CODE_SEGMENT_COUNT = 8;
+struct CodeSegment
+{
+  JitCodeBuffer buffer;
+
+  // zero if the segment hasn't been used since the last flush
+  u32 generation;
+};
+static std::array<CodeSegment, RECOMPILER_CODE_SEGMENT_COUNT> s_code_segments;
+static u32 s_code_segment_size = 0;
+static u32 s_current_code_segment = 0;
+static u32 s_code_generation = 0;
+#endif
 
 enum : u32
 {
@@ -32,8 +63,6 @@ enum : u32
   FAST_MAP_TOTAL_SLOT_COUNT = FAST_MAP_RAM_SLOT_COUNT + FAST_MAP_BIOS_SLOT_COUNT,
 };
 
-std::array<CodeBlock::HostCodePointer, FAST_MAP_TOTAL_SLOT_COUNT> s_fast_map;
-
 ALWAYS_INLINE static u32 GetFastMapIndex(u32 pc)
 {
   return ((pc & PHYSICAL_MEMORY_ADDRESS_MASK) >= Bus::BIOS_BASE) ?
@@ -41,6 +70,9 @@ ALWAYS_INLINE static u32 GetFastMapIndex(u32 pc)
            ((pc & Bus::RAM_MASK) >> 2);
 }
 
+#ifdef WITH_RECOMPILER
+std::array<CodeBlock::HostCodePointer, FAST_MAP_TOTAL_SLOT_COUNT> s_fast_map;
+
 static void FastCompileBlockFunction();
 
 static void ResetFastMap()
@@ -53,9 +85,43 @@ static void SetFastMap(u32 pc, CodeBlock::HostCodePointer function)
   s_fast_map[GetFastMapIndex(pc)] = function;
 }
 
+CodeBlock* g_link_pending_block = nullptr;
+
+/// Links the block which exited through an unlinked exit to the block which is about to be executed.
+static void LinkPendingBlock();
+
+/// Points the exits of from which branch to pc at the specified code, or back to the dispatcher if null.
+static void PatchBlockExits(CodeBlock* from, u32 pc, CodeBlock::HostCodePointer code);
+
+// Used to find the block which owns a faulting host pc.
+using HostCodeMap = std::map<CodeBlock::HostCodePointer, CodeBlock*>;
+static HostCodeMap s_host_code_map;
+static bool s_page_fault_handler_installed = false;
+
+static void AddBlockToHostCodeMap(CodeBlock* block);
+static void RemoveBlockFromHostCodeMap(CodeBlock* block);
+static Common::PageFaultHandler::HandlerResult PageFaultHandler(void* exception_pc, void* fault_address,
+                                                                bool is_write);
+
 #endif
 
-using BlockMap = std::unordered_map<u32, CodeBlock*>;
+// Blocks and their instructions are never freed individually, only when the whole cache is flushed.
+static constexpr u32 BLOCK_SLAB_SIZE = 1024;
+static constexpr u32 INSTRUCTION_SLAB_SIZE = 16384;
+static constexpr u32 MAX_BLOCK_COUNT = 128 * 1024;
+static constexpr u32 MAX_INSTRUCTION_COUNT = 1024 * 1024;
+
+// Superblocks stop following branches once they reach this many instructions.
+static constexpr u32 MAX_SUPERBLOCK_INSTRUCTIONS = 256;
+
+// In tiered mode, blocks are interpreted until they've executed this many times.
+static constexpr u32 TIERED_COMPILE_THRESHOLD = 32;
+
+// Blocks which are modified this many times are assumed to be self-modifying, and are never compiled in tiered mode.
+static constexpr u32 TIERED_MAX_RECOMPILES = 4;
+
+using BlockAllocator = SlabAllocator<CodeBlock, BLOCK_SLAB_SIZE>;
+using InstructionAllocator = SlabAllocator<CodeBlockInstruction, INSTRUCTION_SLAB_SIZE>;
 
 void LogCurrentState();
 
@@ -65,11 +131,58 @@ static CodeBlockKey GetNextBlockKey();
 /// Looks up the block in the cache if it's already been compiled.
 static CodeBlock* LookupBlock(CodeBlockKey key);
 
+/// Returns the block for the key if it exists, without decoding or revalidating it.
+static CodeBlock* FindBlock(CodeBlockKey key);
+
 /// Can the current block execute? This will re-validate the block if necessary.
 /// The block can also be flushed if recompilation failed, so ignore the pointer if false is returned.
 static bool RevalidateBlock(CodeBlock* block);
 
+/// Hashes the block's guest code directly from memory, so revalidating an unchanged block doesn't need to compare every
+/// instruction.
+static u64 HashBlockCode(const CodeBlock* block);
+
+/// Decodes the instructions at the specified key into the decode buffer. Returns false if the block is empty.
+static bool DecodeBlock(CodeBlockKey key);
+
+/// Flushes the whole cache if the decoded block would not fit. Any block pointers are invalid if true is returned.
+static bool FlushIfOutOfSpace();
+
+/// Copies the decoded instructions to the block, and generates host code for it unless tiered compilation is enabled.
 static bool CompileBlock(CodeBlock* block);
+
+/// Returns true if the block is a loop which does the same thing every iteration until an event changes what it reads,
+/// e.g. polling a status register. Such loops can skip ahead to the next event.
+static bool IsIdleLoop(const CodeBlock* block);
+
+#ifdef WITH_RECOMPILER
+/// Splits the code storage into segments, sized from the code cache size setting.
+static void InitializeCodeSegments();
+static void DestroyCodeSegments();
+
+/// Returns the code buffer of the segment which is currently being filled.
+static JitCodeBuffer* GetCodeBuffer();
+
+/// Switches to the oldest segment if host code for the specified number of instructions would not fit.
+static void EnsureCodeSpace(u32 num_instructions);
+
+/// Discards the host code of every block in the oldest segment, and makes it the current segment.
+static void EvictOldestCodeSegment();
+
+/// Unlinks the block and forgets its host code, so it's interpreted until it's compiled again.
+static void DiscardHostCode(CodeBlock* block);
+
+/// Generates host code for the block's instructions, replacing any previous code.
+static bool CompileHostCode(CodeBlock* block);
+
+/// Returns true if an interpreted block has executed enough times to be compiled.
+static bool ShouldCompileBlock(CodeBlock* block);
+
+/// Attaches host code from the compile thread to its blocks.
+static void PublishCompiledBlocks();
+#endif
+
+static CodeBlock* AllocateBlock(CodeBlockKey key);
 static void FlushBlock(CodeBlock* block);
 static void AddBlockToPageMap(CodeBlock* block);
 static void RemoveBlockFromPageMap(CodeBlock* block);
@@ -81,22 +194,47 @@ static void LinkBlock(CodeBlock* from, CodeBlock* to);
 static void UnlinkBlock(CodeBlock* block);
 
 static bool s_use_recompiler = false;
-static BlockMap s_blocks;
+static BlockAllocator s_block_allocator;
+static InstructionAllocator s_instruction_allocator;
+static std::vector<CodeBlockInstruction> s_decode_buffer;
+static u32 s_flush_count = 0;
+static Statistics s_statistics = {};
+
+// Blocks indexed by physical address, with blocks for different virtual addresses or modes chained in the same slot.
+static std::array<CodeBlock*, FAST_MAP_TOTAL_SLOT_COUNT> s_block_table;
 static std::array<std::vector<CodeBlock*>, CPU_CODE_CACHE_PAGE_COUNT> m_ram_block_map;
 
+// Blocks point into the profile map, so entries are only removed once all blocks are gone.
+static std::unordered_map<u32, CodeBlockProfile> s_block_profiles;
+static bool s_profiling = false;
+
+ALWAYS_INLINE static void UpdateBlockProfile(CodeBlock* block, TickCount ticks)
+{
+  if (block && block->profile)
+  {
+    block->profile->execution_count++;
+    block->profile->ticks += static_cast<u64>(ticks);
+  }
+}
+
 void Initialize(bool use_recompiler)
 {
-  Assert(s_blocks.empty());
+  Assert(s_block_allocator.GetAllocatedCount() == 0);
+  s_block_table.fill(nullptr);
+  s_statistics = {};
+  s_profiling = g_settings.debugging.show_code_cache_profile;
 
 #ifdef WITH_RECOMPILER
   s_use_recompiler = use_recompiler;
-  if (!s_code_buffer.Initialize(s_code_storage, sizeof(s_code_storage), RECOMPILER_FAR_CODE_CACHE_SIZE,
-                                RECOMPILER_GUARD_SIZE))
-  {
-    Panic("Failed to initialize code space");
-  }
-
+  Recompiler::CodeGenerator::UpdateHostFeatures();
+  InitializeCodeSegments();
   ResetFastMap();
+
+  s_page_fault_handler_installed = Common::PageFaultHandler::InstallHandler(&s_host_code_map, PageFaultHandler);
+  if (!s_page_fault_handler_installed)
+    Log_WarningPrint("Failed to install page fault handler, fastmem and code page protection will not be available.");
+
+  Bus::SetCodePageWriteProtection(IsUsingCodePageProtection());
 #else
   s_use_recompiler = false;
 #endif
@@ -104,16 +242,47 @@ void Initialize(bool use_recompiler)
 
 void Shutdown()
 {
+  Log_InfoPrintf("%u block revalidations, %u hash mismatches, %u recompiles", s_statistics.num_revalidations,
+                 s_statistics.num_hash_mismatches, s_statistics.num_recompiles);
+
   Flush();
 #ifdef WITH_RECOMPILER
-  s_code_buffer.Destroy();
+  if (s_page_fault_handler_installed)
+  {
+    Common::PageFaultHandler::RemoveHandler(&s_host_code_map);
+    s_page_fault_handler_installed = false;
+  }
+
+  Recompiler::CompileThread::Stop();
+  Recompiler::DiskCache::Close();
+  DestroyCodeSegments();
 #endif
+
+  s_block_allocator.Clear();
+  s_instruction_allocator.Clear();
+  s_decode_buffer.clear();
+  s_decode_buffer.shrink_to_fit();
+  s_block_profiles.clear();
+}
+
+/// The profile window can be closed or the option toggled at any time. Blocks aren't linked while profiling, and only
+/// get a profile when they're allocated, so the cache is rebuilt whenever profiling is switched on or off.
+static void UpdateProfiling()
+{
+  if (s_profiling == g_settings.debugging.show_code_cache_profile)
+    return;
+
+  Log_InfoPrintf("Code cache profiling %s, flushing all blocks.",
+                 g_settings.debugging.show_code_cache_profile ? "enabled" : "disabled");
+  Flush();
 }
 
 void Execute()
 {
   CodeBlockKey next_block_key;
 
+  UpdateProfiling();
+
   g_state.frame_done = false;
   while (!g_state.frame_done)
   {
@@ -150,14 +319,19 @@ void Execute()
       LogCurrentState();
 #endif
 
-      if (s_use_recompiler)
       {
-        g_state.current_instruction_pc = g_state.regs.pc;
-        block->host_code();
-      }
-      else
-      {
-        InterpretCachedBlock(*block);
+        const TickCount start_ticks = g_state.pending_ticks;
+        if (s_use_recompiler && block->host_code)
+        {
+          g_state.current_instruction_pc = g_state.regs.pc;
+          block->host_code();
+        }
+        else
+        {
+          InterpretCachedBlock(*block);
+        }
+
+        UpdateBlockProfile(block, g_state.pending_ticks - start_ticks);
       }
 
       if (g_state.pending_ticks >= g_state.downcount)
@@ -194,11 +368,14 @@ void Execute()
         }
 
         // No acceptable blocks found in the successor list, try a new one.
+        // Compiling it can flush the cache, in which case the previous block no longer exists.
+        const u32 flush_count = s_flush_count;
         CodeBlock* next_block = LookupBlock(next_block_key);
         if (next_block)
         {
           // Link the previous block to this new block if we find a new block.
-          LinkBlock(block, next_block);
+          if (s_flush_count == flush_count)
+            LinkBlock(block, next_block);
           block = next_block;
           goto reexecute_block;
         }
@@ -216,6 +393,8 @@ void Execute()
 
 void ExecuteRecompiler()
 {
+  UpdateProfiling();
+
   g_state.frame_done = false;
   while (!g_state.frame_done)
   {
@@ -232,7 +411,21 @@ void ExecuteRecompiler()
       const u32 pc = g_state.regs.pc;
       g_state.current_instruction_pc = pc;
       const u32 fast_map_index = GetFastMapIndex(pc);
-      s_fast_map[fast_map_index]();
+      if (!s_profiling)
+      {
+        s_fast_map[fast_map_index]();
+      }
+      else
+      {
+        // Blocks aren't linked while profiling, so every block comes back here.
+        const CodeBlockKey key = GetNextBlockKey();
+        const TickCount start_ticks = g_state.pending_ticks;
+        s_fast_map[fast_map_index]();
+        UpdateBlockProfile(FindBlock(key), g_state.pending_ticks - start_ticks);
+      }
+
+      if (g_link_pending_block)
+        LinkPendingBlock();
     }
 
     TimingEvents::RunEvents();
@@ -255,21 +448,236 @@ void SetUseRecompiler(bool enable)
 #endif
 }
 
+bool IsUsingFastmem()
+{
+#ifdef WITH_RECOMPILER
+  return (s_use_recompiler && s_page_fault_handler_installed && g_settings.IsUsingFastmem());
+#else
+  return false;
+#endif
+}
+
+bool IsUsingCodePageProtection()
+{
+#ifdef WITH_RECOMPILER
+  return (s_page_fault_handler_installed && g_settings.cpu_code_page_protection);
+#else
+  return false;
+#endif
+}
+
+void OpenDiskCache(const BIOS::Hash& bios_hash)
+{
+#ifdef WITH_RECOMPILER
+  if (s_use_recompiler && g_settings.cpu_recompiler_disk_cache)
+    Recompiler::DiskCache::Open(bios_hash);
+#endif
+}
+
 void Flush()
 {
+#ifdef WITH_RECOMPILER
+  // The compile thread could be using the instructions or the disk cache.
+  Recompiler::CompileThread::Reset();
+#endif
+
   Bus::ClearRAMCodePageFlags();
+  Bus::SetCodePageWriteProtection(IsUsingCodePageProtection());
   for (auto& it : m_ram_block_map)
     it.clear();
 
-  for (const auto& it : s_blocks)
-    delete it.second;
-  s_blocks.clear();
+  s_block_table.fill(nullptr);
+  s_block_allocator.Reset();
+  s_instruction_allocator.Reset();
+  s_flush_count++;
+  s_profiling = g_settings.debugging.show_code_cache_profile;
 #ifdef WITH_RECOMPILER
-  s_code_buffer.Reset();
+  s_host_code_map.clear();
+  g_link_pending_block = nullptr;
   ResetFastMap();
+
+  // Picks up any change to the code cache size or host features.
+  Recompiler::CodeGenerator::UpdateHostFeatures();
+  DestroyCodeSegments();
+  InitializeCodeSegments();
 #endif
 }
 
+const Statistics& GetStatistics()
+{
+  return s_statistics;
+}
+
+void ResetProfile()
+{
+  // The sizes describe the current code, so they're kept.
+  for (auto& it : s_block_profiles)
+  {
+    CodeBlockProfile& profile = it.second;
+    profile.execution_count = 0;
+    profile.ticks = 0;
+    profile.invalidation_count = 0;
+    profile.compile_time_ms = 0.0f;
+  }
+}
+
+static std::vector<std::pair<CodeBlockKey, const CodeBlockProfile*>> GetSortedProfiles(u64* total_ticks)
+{
+  std::vector<std::pair<CodeBlockKey, const CodeBlockProfile*>> profiles;
+  profiles.reserve(s_block_profiles.size());
+  *total_ticks = 0;
+  for (const auto& it : s_block_profiles)
+  {
+    CodeBlockKey key;
+    key.bits = it.first;
+    profiles.emplace_back(key, &it.second);
+    *total_ticks += it.second.ticks;
+  }
+
+  std::sort(profiles.begin(), profiles.end(),
+            [](const auto& lhs, const auto& rhs) { return lhs.second->ticks > rhs.second->ticks; });
+  return profiles;
+}
+
+bool WriteProfileReport(const char* filename)
+{
+  std::FILE* fp = FileSystem::OpenCFile(filename, "wb");
+  if (!fp)
+  {
+    Log_ErrorPrintf("Failed to open '%s' for writing", filename);
+    return false;
+  }
+
+  u64 total_ticks;
+  const auto profiles = GetSortedProfiles(&total_ticks);
+  std::fprintf(fp, "%u blocks, %llu ticks\n", static_cast<u32>(profiles.size()),
+               static_cast<unsigned long long>(total_ticks));
+
+  SmallString disasm;
+  for (const auto& [key, profile] : profiles)
+  {
+    if (profile->execution_count == 0)
+      break;
+
+    std::fprintf(fp,
+                 "\n%08X%s: %llu executions, %llu ticks (%.2f%%), %u instructions, %u host bytes, %u invalidations, "
+                 "%.3f ms compiling\n",
+                 key.GetPC(), key.user_mode ? " (user)" : "", static_cast<unsigned long long>(profile->execution_count),
+                 static_cast<unsigned long long>(profile->ticks),
+                 (total_ticks > 0) ? (static_cast<double>(profile->ticks) * 100.0 / static_cast<double>(total_ticks)) :
+                                     0.0,
+                 profile->num_instructions, profile->host_code_size, profile->invalidation_count,
+                 profile->compile_time_ms);
+
+    // The instructions are only around if the block hasn't been flushed.
+    const CodeBlock* block = FindBlock(key);
+    if (!block)
+      continue;
+
+    for (u32 i = 0; i < block->num_instructions; i++)
+    {
+      const CodeBlockInstruction& cbi = block->instructions[i];
+      DisassembleInstruction(&disasm, cbi.pc, cbi.instruction.bits);
+      std::fprintf(fp, "  %08X  %08X  %s\n", cbi.pc, cbi.instruction.bits, disasm.GetCharArray());
+    }
+  }
+
+  std::fclose(fp);
+  Log_InfoPrintf("Wrote code cache profile to '%s'", filename);
+  return true;
+}
+
+void DrawProfileWindow()
+{
+  static constexpr u32 NUM_COLUMNS = 8;
+  static constexpr u32 MAX_ROWS = 200;
+  static constexpr std::array<const char*, NUM_COLUMNS> column_names = {
+    {"PC", "Executions", "Ticks", "%", "Instructions", "Host Bytes", "Invalidations", "Compile ms"}};
+
+  const float framebuffer_scale = ImGui::GetIO().DisplayFramebufferScale.x;
+
+  ImGui::SetNextWindowSize(ImVec2(800.0f * framebuffer_scale, 500.0f * framebuffer_scale), ImGuiCond_FirstUseEver);
+  if (!ImGui::Begin("Code Cache Profile", &g_settings.debugging.show_code_cache_profile))
+  {
+    ImGui::End();
+    return;
+  }
+
+  if (!s_profiling)
+  {
+    ImGui::TextUnformatted("Blocks will be profiled from the next frame.");
+    ImGui::End();
+    return;
+  }
+
+  if (ImGui::Button("Reset"))
+    ResetProfile();
+  ImGui::SameLine();
+  if (ImGui::Button("Save Report"))
+  {
+    const std::string filename = g_host_interface->GetUserDirectoryRelativePath("codecache_profile.txt");
+    if (WriteProfileReport(filename.c_str()))
+      g_host_interface->AddFormattedOSDMessage(5.0f, "Code cache profile saved to '%s'.", filename.c_str());
+  }
+
+  u64 total_ticks;
+  const auto profiles = GetSortedProfiles(&total_ticks);
+  ImGui::SameLine();
+  ImGui::Text("%u blocks", static_cast<u32>(profiles.size()));
+
+  ImGui::Columns(NUM_COLUMNS);
+  for (const char* title : column_names)
+  {
+    ImGui::TextUnformatted(title);
+    ImGui::NextColumn();
+  }
+
+  SmallString disasm;
+  const u32 num_rows = std::min(static_cast<u32>(profiles.size()), MAX_ROWS);
+  for (u32 row = 0; row < num_rows; row++)
+  {
+    const CodeBlockKey key = profiles[row].first;
+    const CodeBlockProfile* profile = profiles[row].second;
+    ImGui::Text("%08X", key.GetPC());
+    if (ImGui::IsItemHovered())
+    {
+      // Show the block's code, if it's still around.
+      const CodeBlock* block = FindBlock(key);
+      if (block && block->num_instructions > 0)
+      {
+        ImGui::BeginTooltip();
+        for (u32 i = 0; i < block->num_instructions; i++)
+        {
+          const CodeBlockInstruction& cbi = block->instructions[i];
+          DisassembleInstruction(&disasm, cbi.pc, cbi.instruction.bits);
+          ImGui::Text("%08X  %s", cbi.pc, disasm.GetCharArray());
+        }
+        ImGui::EndTooltip();
+      }
+    }
+    ImGui::NextColumn();
+    ImGui::Text("%llu", static_cast<unsigned long long>(profile->execution_count));
+    ImGui::NextColumn();
+    ImGui::Text("%llu", static_cast<unsigned long long>(profile->ticks));
+    ImGui::NextColumn();
+    ImGui::Text("%.2f",
+                (total_ticks > 0) ? (static_cast<double>(profile->ticks) * 100.0 / static_cast<double>(total_ticks)) :
+                                    0.0);
+    ImGui::NextColumn();
+    ImGui::Text("%u", profile->num_instructions);
+    ImGui::NextColumn();
+    ImGui::Text("%u", profile->host_code_size);
+    ImGui::NextColumn();
+    ImGui::Text("%u", profile->invalidation_count);
+    ImGui::NextColumn();
+    ImGui::Text("%.3f", profile->compile_time_ms);
+    ImGui::NextColumn();
+  }
+
+  ImGui::Columns(1);
+  ImGui::End();
+}
+
 void LogCurrentState()
 {
   const auto& regs = g_state.regs;
@@ -295,59 +703,154 @@ CodeBlockKey GetNextBlockKey()
 
 CodeBlock* LookupBlock(CodeBlockKey key)
 {
-  BlockMap::iterator iter = s_blocks.find(key.bits);
-  if (iter != s_blocks.end())
+  for (CodeBlock* existing_block = s_block_table[GetFastMapIndex(key.GetPC())]; existing_block;
+       existing_block = existing_block->next_in_slot)
   {
+    if (existing_block->key != key)
+      continue;
+
+    // blocks which failed to compile are kept around, so we don't try again
+    if (existing_block->num_instructions == 0)
+      return nullptr;
+
     // ensure it hasn't been invalidated
-    CodeBlock* existing_block = iter->second;
-    if (!existing_block || !existing_block->invalidated || RevalidateBlock(existing_block))
+    if (!existing_block->invalidated || RevalidateBlock(existing_block))
       return existing_block;
+
+    break;
   }
 
-  CodeBlock* block = new CodeBlock(key);
-  if (CompileBlock(block))
+  const bool decoded = DecodeBlock(key);
+  if (decoded)
+    FlushIfOutOfSpace();
+
+  CodeBlock* block = AllocateBlock(key);
+  if (decoded && CompileBlock(block))
   {
     // add it to the page map if it's in ram
     AddBlockToPageMap(block);
 
 #ifdef WITH_RECOMPILER
-    SetFastMap(block->GetPC(), block->host_code);
+    // interpreted blocks go through the dispatcher until they're compiled
+    if (block->host_code)
+      SetFastMap(block->GetPC(), block->host_code);
 #endif
   }
   else
   {
     Log_ErrorPrintf("Failed to compile block at PC=0x%08X", key.GetPC());
-    delete block;
+    block->num_instructions = 0;
     block = nullptr;
   }
 
-  iter = s_blocks.emplace(key.bits, block).first;
   return block;
 }
 
+CodeBlock* FindBlock(CodeBlockKey key)
+{
+  for (CodeBlock* block = s_block_table[GetFastMapIndex(key.GetPC())]; block; block = block->next_in_slot)
+  {
+    if (block->key == key)
+      return block;
+  }
+
+  return nullptr;
+}
+
+CodeBlock* AllocateBlock(CodeBlockKey key)
+{
+  CodeBlock* block = s_block_allocator.Allocate();
+  block->Reset(key);
+  if (s_profiling)
+    block->profile = &s_block_profiles[key.bits];
+
+  CodeBlock*& slot = s_block_table[GetFastMapIndex(key.GetPC())];
+  block->next_in_slot = slot;
+  slot = block;
+  return block;
+}
+
+static const u8* GetCodePointer(u32 pc)
+{
+  const PhysicalMemoryAddress address = pc & PHYSICAL_MEMORY_ADDRESS_MASK;
+  return (address < Bus::RAM_MIRROR_END) ? &Bus::g_ram[address & Bus::RAM_MASK] :
+                                           &Bus::g_bios[(address - Bus::BIOS_BASE) & Bus::BIOS_MASK];
+}
+
+u64 HashBlockCode(const CodeBlock* block)
+{
+  // Superblocks aren't contiguous, so each run of adjacent instructions is hashed separately.
+  u64 hash = 0;
+  const u8* run_start = GetCodePointer(block->instructions[0].pc);
+  const u8* run_end = run_start + sizeof(u32);
+  for (u32 i = 1; i < block->num_instructions; i++)
+  {
+    const u8* ptr = GetCodePointer(block->instructions[i].pc);
+    if (ptr == run_end)
+    {
+      run_end += sizeof(u32);
+      continue;
+    }
+
+    hash = XXH3_64bits_withSeed(run_start, static_cast<size_t>(run_end - run_start), hash);
+    run_start = ptr;
+    run_end = ptr + sizeof(u32);
+  }
+
+  return XXH3_64bits_withSeed(run_start, static_cast<size_t>(run_end - run_start), hash);
+}
+
 bool RevalidateBlock(CodeBlock* block)
 {
-  for (const CodeBlockInstruction& cbi : block->instructions)
+  s_statistics.num_revalidations++;
+
+  // Writes to data in the same page are much more common than changes to the code itself.
+  const u64 code_hash = HashBlockCode(block);
+  if (code_hash != block->code_hash)
   {
-    u32 new_code = Bus::ReadCacheableAddress(cbi.pc & PHYSICAL_MEMORY_ADDRESS_MASK);
-    if (cbi.instruction.bits != new_code)
+    s_statistics.num_hash_mismatches++;
+    for (u32 i = 0; i < block->num_instructions; i++)
     {
-      Log_DebugPrintf("Block 0x%08X changed at PC 0x%08X - %08X to %08X - recompiling.", block->GetPC(), cbi.pc,
-                      cbi.instruction.bits, new_code);
-      goto recompile;
+      const CodeBlockInstruction& cbi = block->instructions[i];
+      u32 new_code = Bus::ReadCacheableAddress(cbi.pc & PHYSICAL_MEMORY_ADDRESS_MASK);
+      if (cbi.instruction.bits != new_code)
+      {
+        Log_DebugPrintf("Block 0x%08X changed at PC 0x%08X - %08X to %08X - recompiling.", block->GetPC(), cbi.pc,
+                        cbi.instruction.bits, new_code);
+        goto recompile;
+      }
     }
+
+    block->code_hash = code_hash;
   }
 
   // re-add it to the page map since it's still up-to-date
   block->invalidated = false;
   AddBlockToPageMap(block);
 #ifdef WITH_RECOMPILER
-  SetFastMap(block->GetPC(), block->host_code);
+  if (block->host_code)
+    SetFastMap(block->GetPC(), block->host_code);
 #endif
   return true;
 
 recompile:
-  block->instructions.clear();
+  s_statistics.num_recompiles++;
+
+  // the new code has to prove it's hot before it's compiled again
+  block->execution_count = 0;
+  block->recompile_count++;
+
+  if (!DecodeBlock(block->key))
+  {
+    Log_WarningPrintf("Failed to decode block 0x%08X - flushing.", block->GetPC());
+    FlushBlock(block);
+    return false;
+  }
+
+  // the block itself is gone if everything was flushed
+  if (FlushIfOutOfSpace())
+    return false;
+
   if (!CompileBlock(block))
   {
     Log_WarningPrintf("Failed to recompile block 0x%08X - flushing.", block->GetPC());
@@ -362,17 +865,71 @@ recompile:
   return true;
 }
 
-bool CompileBlock(CodeBlock* block)
+/// Returns true if the branch is always taken, i.e. it's unconditional, or compares a register against itself.
+static bool GetAlwaysTakenBranchTarget(const CodeBlockInstruction& cbi, u32* target)
+{
+  const Instruction& instruction = cbi.instruction;
+  switch (instruction.op)
+  {
+    case InstructionOp::j:
+    case InstructionOp::jal:
+      *target = ((cbi.pc + 4) & UINT32_C(0xF0000000)) | (instruction.j.target << 2);
+      return true;
+
+    case InstructionOp::beq:
+      *target = cbi.pc + 4 + (instruction.i.imm_sext32() << 2);
+      return (instruction.i.rs == instruction.i.rt);
+
+    case InstructionOp::blez:
+      *target = cbi.pc + 4 + (instruction.i.imm_sext32() << 2);
+      return (instruction.i.rs == Reg::zero);
+
+    case InstructionOp::b:
+    {
+      // bgez/bgezal zero
+      *target = cbi.pc + 4 + (instruction.i.imm_sext32() << 2);
+      const u8 rt = static_cast<u8>(instruction.i.rt.GetValue());
+      return (instruction.i.rs == Reg::zero && (rt & u8(1)) != 0);
+    }
+
+    default:
+      return false;
+  }
+}
+
+/// Returns the target of the branch before the delay slot, if the block should continue there instead of ending.
+static bool ShouldFollowBranch(CodeBlockKey key, const CodeBlockInstruction& branch, u32* target)
 {
-  u32 pc = block->GetPC();
+  if (branch.is_branch_delay_slot || !GetAlwaysTakenBranchTarget(branch, target) ||
+      s_decode_buffer.size() >= MAX_SUPERBLOCK_INSTRUCTIONS)
+  {
+    return false;
+  }
+
+  // The block is only tracked in the RAM page map if it starts in RAM.
+  const bool start_in_ram = (key.GetPCPhysicalAddress() < Bus::RAM_SIZE);
+  if (((*target & PHYSICAL_MEMORY_ADDRESS_MASK) < Bus::RAM_SIZE) != start_in_ram)
+    return false;
+
+  // Loops are left to the dispatcher, rather than being unrolled.
+  return std::none_of(s_decode_buffer.begin(), s_decode_buffer.end(),
+                      [target](const CodeBlockInstruction& cbi) { return cbi.pc == *target; });
+}
+
+bool DecodeBlock(CodeBlockKey key)
+{
+  u32 pc = key.GetPC();
   bool is_branch_delay_slot = false;
   bool is_load_delay_slot = false;
+  const bool user_mode = key.user_mode;
+  const bool follow_branches = s_use_recompiler && g_settings.cpu_recompiler_superblocks;
 
 #if 0
   if (pc == 0x0005aa90)
     __debugbreak();
 #endif
 
+  s_decode_buffer.clear();
   for (;;)
   {
     CodeBlockInstruction cbi = {};
@@ -392,16 +949,30 @@ bool CompileBlock(CodeBlock* block)
     cbi.is_load_instruction = IsMemoryLoadInstruction(cbi.instruction);
     cbi.is_store_instruction = IsMemoryStoreInstruction(cbi.instruction);
     cbi.has_load_delay = InstructionHasLoadDelay(cbi.instruction);
-    cbi.can_trap = CanInstructionTrap(cbi.instruction, InUserMode());
+    cbi.can_trap = CanInstructionTrap(cbi.instruction, user_mode);
+    PredecodeInstruction(&cbi);
 
     // instruction is decoded now
-    block->instructions.push_back(cbi);
+    s_decode_buffer.push_back(cbi);
     pc += sizeof(cbi.instruction.bits);
 
     // if we're in a branch delay slot, the block is now done
     // except if this is a branch in a branch delay slot, then we grab the one after that, and so on...
+    // superblocks carry on at the target of branches which are always taken, keeping registers cached across them
     if (is_branch_delay_slot && !cbi.is_branch_instruction)
-      break;
+    {
+      u32 target;
+      if (!follow_branches || IsExitBlockInstruction(cbi.instruction) ||
+          !ShouldFollowBranch(key, s_decode_buffer[s_decode_buffer.size() - 2], &target))
+      {
+        break;
+      }
+
+      pc = target;
+      is_branch_delay_slot = false;
+      is_load_delay_slot = cbi.has_load_delay;
+      continue;
+    }
 
     // if this is a branch, we grab the next instruction (delay slot), and then exit
     is_branch_delay_slot = cbi.is_branch_instruction;
@@ -414,61 +985,521 @@ bool CompileBlock(CodeBlock* block)
       break;
   }
 
-  if (!block->instructions.empty())
+  if (s_decode_buffer.empty())
   {
-    block->instructions.back().is_last_instruction = true;
+    Log_WarningPrintf("Empty block compiled at 0x%08X", key.GetPC());
+    return false;
+  }
+
+  s_decode_buffer.back().is_last_instruction = true;
 
 #ifdef _DEBUG
-    SmallString disasm;
-    Log_DebugPrintf("Block at 0x%08X", block->GetPC());
-    for (const CodeBlockInstruction& cbi : block->instructions)
-    {
-      CPU::DisassembleInstruction(&disasm, cbi.pc, cbi.instruction.bits, nullptr);
-      Log_DebugPrintf("[%s %s 0x%08X] %08X %s", cbi.is_branch_delay_slot ? "BD" : "  ",
-                      cbi.is_load_delay_slot ? "LD" : "  ", cbi.pc, cbi.instruction.bits, disasm.GetCharArray());
-    }
-#endif
+  SmallString disasm;
+  Log_DebugPrintf("Block at 0x%08X", key.GetPC());
+  for (const CodeBlockInstruction& cbi : s_decode_buffer)
+  {
+    CPU::DisassembleInstruction(&disasm, cbi.pc, cbi.instruction.bits, nullptr);
+    Log_DebugPrintf("[%s %s 0x%08X] %08X %s", cbi.is_branch_delay_slot ? "BD" : "  ",
+                    cbi.is_load_delay_slot ? "LD" : "  ", cbi.pc, cbi.instruction.bits, disasm.GetCharArray());
   }
-  else
+#endif
+
+  return true;
+}
+
+bool FlushIfOutOfSpace()
+{
+  const u32 num_instructions = static_cast<u32>(s_decode_buffer.size());
+  if ((s_block_allocator.GetAllocatedCount() + 1) > MAX_BLOCK_COUNT ||
+      (s_instruction_allocator.GetAllocatedCount() + num_instructions) > MAX_INSTRUCTION_COUNT)
   {
-    Log_WarningPrintf("Empty block compiled at 0x%08X", block->key.GetPC());
-    return false;
+    Log_WarningPrintf("Out of block space, flushing all blocks.");
+    Flush();
+    return true;
   }
 
 #ifdef WITH_RECOMPILER
+  // Ensure we're not going to run out of space while compiling this block.
   if (s_use_recompiler)
+    EnsureCodeSpace(num_instructions);
+#endif
+
+  return false;
+}
+
+#ifdef WITH_RECOMPILER
+
+void InitializeCodeSegments()
+{
+  const u32 cache_size_mb = std::clamp(g_settings.cpu_recompiler_code_cache_size, RECOMPILER_MIN_CODE_CACHE_SIZE_MB,
+                                       RECOMPILER_MAX_CODE_CACHE_SIZE_MB);
+  s_code_segment_size = (cache_size_mb * 1024 * 1024) / RECOMPILER_CODE_SEGMENT_COUNT;
+
+  // Half of each segment is used for far code, the same as when the cache was a single buffer.
+  for (u32 i = 0; i < RECOMPILER_CODE_SEGMENT_COUNT; i++)
   {
-    // Ensure we're not going to run out of space while compiling this block.
-    if (s_code_buffer.GetFreeCodeSpace() <
-          (block->instructions.size() * Recompiler::MAX_NEAR_HOST_BYTES_PER_INSTRUCTION) ||
-        s_code_buffer.GetFreeFarCodeSpace() <
-          (block->instructions.size() * Recompiler::MAX_FAR_HOST_BYTES_PER_INSTRUCTION))
+    CodeSegment& segment = s_code_segments[i];
+    if (!segment.buffer.Initialize(&s_code_storage[i * s_code_segment_size], s_code_segment_size,
+                                   s_code_segment_size / 2, RECOMPILER_GUARD_SIZE))
     {
-      Log_WarningPrintf("Out of code space, flushing all blocks.");
-      Flush();
+      Panic("Failed to initialize code space");
     }
 
-    Recompiler::CodeGenerator codegen(&s_code_buffer);
-    if (!codegen.CompileBlock(block, &block->host_code, &block->host_code_size))
+    segment.generation = 0;
+  }
+
+  s_current_code_segment = 0;
+  s_code_generation = 1;
+  s_code_segments[0].generation = s_code_generation;
+}
+
+void DestroyCodeSegments()
+{
+  for (CodeSegment& segment : s_code_segments)
+    segment.buffer.Destroy();
+}
+
+JitCodeBuffer* GetCodeBuffer()
+{
+  return &s_code_segments[s_current_code_segment].buffer;
+}
+
+void EnsureCodeSpace(u32 num_instructions)
+{
+  const JitCodeBuffer* buffer = GetCodeBuffer();
+  if (buffer->GetFreeCodeSpace() < (num_instructions * Recompiler::MAX_NEAR_HOST_BYTES_PER_INSTRUCTION) ||
+      buffer->GetFreeFarCodeSpace() < (num_instructions * Recompiler::MAX_FAR_HOST_BYTES_PER_INSTRUCTION))
+  {
+    EvictOldestCodeSegment();
+  }
+}
+
+void EvictOldestCodeSegment()
+{
+  u32 oldest = 0;
+  for (u32 i = 1; i < RECOMPILER_CODE_SEGMENT_COUNT; i++)
+  {
+    if (s_code_segments[i].generation < s_code_segments[oldest].generation)
+      oldest = i;
+  }
+
+  // A block's far code is always in the same segment as its near code, so the host code pointer is enough.
+  CodeSegment& segment = s_code_segments[oldest];
+  u32 num_evicted = 0;
+  if (segment.generation != 0)
+  {
+    const auto start = reinterpret_cast<CodeBlock::HostCodePointer>(&s_code_storage[oldest * s_code_segment_size]);
+    const auto end = reinterpret_cast<CodeBlock::HostCodePointer>(&s_code_storage[(oldest + 1) * s_code_segment_size]);
+    std::vector<CodeBlock*> blocks;
+    for (auto iter = s_host_code_map.lower_bound(start); iter != s_host_code_map.end() && iter->first < end; ++iter)
+      blocks.push_back(iter->second);
+
+    // The blocks stay in the cache, and are compiled again by the dispatcher the next time they're executed.
+    for (CodeBlock* block : blocks)
     {
-      Log_ErrorPrintf("Failed to compile host code for block at 0x%08X", block->key.GetPC());
-      return false;
+      if (g_link_pending_block == block)
+        g_link_pending_block = nullptr;
+
+      DiscardHostCode(block);
+      SetFastMap(block->GetPC(), FastCompileBlockFunction);
     }
+
+    num_evicted = static_cast<u32>(blocks.size());
+    segment.buffer.Reset();
   }
+
+  Log_DevPrintf("Evicted %u blocks from code segment %u (generation %u)", num_evicted, oldest, segment.generation);
+  segment.generation = ++s_code_generation;
+  s_current_code_segment = oldest;
+}
+
 #endif
 
+/// Gets the guest registers which the instruction reads and writes. Returns false if the instruction has any other side
+/// effects, or could change what the next iteration of a loop does.
+static bool GetIdleLoopInstructionRegisters(const CodeBlockInstruction& cbi, u32* reads, u32* writes)
+{
+  const Instruction inst = cbi.instruction;
+  const u32 rs = (1u << static_cast<u8>(inst.r.rs.GetValue()));
+  const u32 rt = (1u << static_cast<u8>(inst.r.rt.GetValue()));
+  const u32 rd = (1u << static_cast<u8>(inst.r.rd.GetValue()));
+  switch (inst.op)
+  {
+    case InstructionOp::funct:
+    {
+      switch (inst.r.funct)
+      {
+        case InstructionFunct::sll:
+        case InstructionFunct::srl:
+        case InstructionFunct::sra:
+          *reads = rt;
+          *writes = rd;
+          return true;
+
+        case InstructionFunct::sllv:
+        case InstructionFunct::srlv:
+        case InstructionFunct::srav:
+        case InstructionFunct::and_:
+        case InstructionFunct::or_:
+        case InstructionFunct::xor_:
+        case InstructionFunct::nor:
+        case InstructionFunct::addu:
+        case InstructionFunct::subu:
+        case InstructionFunct::slt:
+        case InstructionFunct::sltu:
+          *reads = rs | rt;
+          *writes = rd;
+          return true;
+
+        default:
+          return false;
+      }
+    }
+
+    case InstructionOp::lui:
+      *reads = 0;
+      *writes = rt;
+      return true;
+
+    case InstructionOp::andi:
+    case InstructionOp::ori:
+    case InstructionOp::xori:
+    case InstructionOp::addiu:
+    case InstructionOp::slti:
+    case InstructionOp::sltiu:
+    case InstructionOp::lb:
+    case InstructionOp::lbu:
+    case InstructionOp::lh:
+    case InstructionOp::lhu:
+    case InstructionOp::lw:
+      *reads = rs;
+      *writes = rt;
+      return true;
+
+    case InstructionOp::j:
+      *reads = 0;
+      *writes = 0;
+      return true;
+
+    case InstructionOp::beq:
+    case InstructionOp::bne:
+      *reads = rs | rt;
+      *writes = 0;
+      return true;
+
+    case InstructionOp::bgtz:
+    case InstructionOp::blez:
+      *reads = rs;
+      *writes = 0;
+      return true;
+
+    case InstructionOp::b:
+    {
+      // the linking variants write ra
+      *reads = rs;
+      *writes = 0;
+      return ((static_cast<u8>(inst.i.rt.GetValue()) & u8(0x1E)) != u8(0x10));
+    }
+
+    default:
+      return false;
+  }
+}
+
+/// Loads in idle loops have to be from RAM or the scratchpad. Skipping iterations which read I/O registers would change
+/// how many reads reach the device, e.g. popping a FIFO, or the value read, like a timer counter.
+static bool IsIdleLoopLoadAddress(VirtualMemoryAddress address)
+{
+  const u32 segment = address >> 29;
+  if (segment != 0x00 && segment != 0x04 && segment != 0x05)
+    return false;
+
+  // the scratchpad isn't accessible through KSEG1
+  const PhysicalMemoryAddress phys_address = address & PHYSICAL_MEMORY_ADDRESS_MASK;
+  if (segment != 0x05 && (phys_address & DCACHE_LOCATION_MASK) == DCACHE_LOCATION)
+    return true;
+
+  return Bus::IsRAMAddress(phys_address);
+}
+
+bool IsIdleLoop(const CodeBlock* block)
+{
+  // The only branch has to be the one at the end, going back to the start of the block.
+  const u32 num_instructions = block->num_instructions;
+  if (num_instructions < 2)
+    return false;
+
+  const CodeBlockInstruction& branch = block->instructions[num_instructions - 2];
+  // jr/jalr are rejected below, their imm isn't a target
+  if (!branch.is_branch_instruction || branch.imm != block->GetPC())
+    return false;
+
+  // Load addresses have to be known, so the base register has to be a constant which the loop builds itself.
+  std::array<u32, 32> constant_values = {};
+  u32 constant_regs = 1u; // zero
+  u32 loop_writes = 0;
+  for (u32 i = 0; i < num_instructions; i++)
+  {
+    const CodeBlockInstruction& cbi = block->instructions[i];
+    u32 reads, writes;
+    if ((cbi.is_branch_instruction && &cbi != &branch) || !GetIdleLoopInstructionRegisters(cbi, &reads, &writes))
+      return false;
+
+    loop_writes |= writes;
+
+    const Instruction inst = cbi.instruction;
+    const u8 rs = static_cast<u8>(inst.i.rs.GetValue());
+    const u8 rt = static_cast<u8>(inst.i.rt.GetValue());
+    const bool rs_constant = (constant_regs & (1u << rs)) != 0;
+    if (cbi.is_load_instruction && (!rs_constant || !IsIdleLoopLoadAddress(constant_values[rs] + inst.i.imm_sext32())))
+      return false;
+
+    if (inst.op == InstructionOp::lui)
+    {
+      constant_values[rt] = inst.i.imm_zext32() << 16;
+      constant_regs |= (1u << rt);
+    }
+    else if (inst.op == InstructionOp::ori && rs_constant)
+    {
+      constant_values[rt] = constant_values[rs] | inst.i.imm_zext32();
+      constant_regs |= (1u << rt);
+    }
+    else if (inst.op == InstructionOp::addiu && rs_constant)
+    {
+      constant_values[rt] = constant_values[rs] + inst.i.imm_sext32();
+      constant_regs |= (1u << rt);
+    }
+    else
+    {
+      constant_regs &= ~writes;
+    }
+
+    constant_values[0] = 0;
+    constant_regs |= 1u;
+  }
+
+  // Registers the loop writes have to be written before they're read, otherwise they carry state from the previous
+  // iteration, like a counter. Loaded values can't be read by the instruction in the load delay slot.
+  u32 written = 1u; // zero
+  u32 delayed_writes = 0;
+  for (u32 i = 0; i < num_instructions; i++)
+  {
+    const CodeBlockInstruction& cbi = block->instructions[i];
+    u32 reads, writes;
+    GetIdleLoopInstructionRegisters(cbi, &reads, &writes);
+    if ((reads & loop_writes & ~written) != 0)
+      return false;
+
+    written |= delayed_writes;
+    delayed_writes = 0;
+    if (cbi.is_load_instruction)
+      delayed_writes = writes;
+    else
+      written |= writes;
+  }
+
   return true;
 }
 
+bool CompileBlock(CodeBlock* block)
+{
+#ifdef WITH_RECOMPILER
+  // The compile thread can't be allowed to see the instructions change underneath it.
+  if (block->compile_queued)
+  {
+    Recompiler::CompileThread::CancelBlock(block);
+    block->compile_queued = false;
+  }
+#endif
+
+  Common::Timer timer;
+
+  // The previous instructions are left in the arena until the next flush.
+  const u32 num_instructions = static_cast<u32>(s_decode_buffer.size());
+  block->instructions = s_instruction_allocator.Allocate(num_instructions);
+  block->num_instructions = num_instructions;
+  std::memcpy(block->instructions, s_decode_buffer.data(), sizeof(CodeBlockInstruction) * num_instructions);
+  block->code_hash = HashBlockCode(block);
+
+  block->idle_loop = g_settings.cpu_idle_loop_skipping && IsIdleLoop(block);
+  if (block->idle_loop)
+    Log_DevPrintf("Found idle loop at 0x%08X", block->GetPC());
+
+  bool result = true;
+#ifdef WITH_RECOMPILER
+  if (s_use_recompiler)
+  {
+    // Blocks start out interpreted in tiered mode, and are compiled by the dispatcher once they're hot. The compile
+    // thread is also fed by the dispatcher.
+    if (g_settings.cpu_recompiler_tiered || g_settings.cpu_recompiler_thread)
+      DiscardHostCode(block);
+    else
+      result = CompileHostCode(block);
+  }
+#endif
+
+  if (block->profile)
+  {
+    block->profile->num_instructions = num_instructions;
+    block->profile->compile_time_ms += static_cast<float>(timer.GetTimeMilliseconds());
+  }
+
+  return result;
+}
+
 #ifdef WITH_RECOMPILER
 
+void DiscardHostCode(CodeBlock* block)
+{
+  // The code itself stays in the code buffer until its segment is evicted, or the cache is flushed.
+  if (block->host_code)
+  {
+    UnlinkBlock(block);
+    RemoveBlockFromHostCodeMap(block);
+    block->host_code = nullptr;
+    block->host_code_size = 0;
+  }
+}
+
+bool CompileHostCode(CodeBlock* block)
+{
+  // Recompiling replaces the old host code.
+  DiscardHostCode(block);
+  block->loadstore_backpatch_info.clear();
+  block->exit_link_info.clear();
+
+  if (Recompiler::DiskCache::LoadBlock(block, GetCodeBuffer(), &block->host_code, &block->host_code_size))
+  {
+    AddBlockToHostCodeMap(block);
+    return true;
+  }
+
+  Recompiler::CodeGenerator codegen(GetCodeBuffer());
+  if (!codegen.CompileBlock(block, &block->host_code, &block->host_code_size))
+  {
+    Log_ErrorPrintf("Failed to compile host code for block at 0x%08X", block->key.GetPC());
+    return false;
+  }
+
+  Recompiler::DiskCache::StoreBlock(block, block->host_code, block->host_code_size, codegen);
+  AddBlockToHostCodeMap(block);
+  return true;
+}
+
+bool ShouldCompileBlock(CodeBlock* block)
+{
+  if (!g_settings.cpu_recompiler_tiered)
+    return true;
+
+  // Self-modifying code would be thrown away soon after compiling it, so it stays in the interpreter.
+  if (block->recompile_count >= TIERED_MAX_RECOMPILES)
+    return false;
+
+  return (++block->execution_count >= TIERED_COMPILE_THRESHOLD);
+}
+
+void PublishCompiledBlocks()
+{
+  Recompiler::CompileThread::CompiledBlock cb;
+  while (Recompiler::CompileThread::GetCompiledBlock(&cb))
+  {
+    if (cb.out_of_space)
+    {
+      Log_WarningPrintf("Out of compile thread code space, flushing all blocks.");
+      Flush();
+      return;
+    }
+
+    CodeBlock* block = cb.block;
+    block->compile_queued = false;
+    if (!cb.host_code)
+    {
+      block->execution_count = 0;
+      continue;
+    }
+
+    // The code was written by another thread, but retrieving it synchronized with that thread.
+    block->host_code = cb.host_code;
+    block->host_code_size = cb.host_code_size;
+    AddBlockToHostCodeMap(block);
+
+    // Invalidated blocks are put back in the fast map when they're revalidated.
+    if (!block->invalidated)
+      SetFastMap(block->GetPC(), block->host_code);
+  }
+}
+
 void FastCompileBlockFunction()
 {
+  if (Recompiler::CompileThread::HasCompiledBlocks())
+    PublishCompiledBlocks();
+
   CodeBlock* block = LookupBlock(GetNextBlockKey());
-  if (block)
-    block->host_code();
-  else
+  if (!block)
+  {
     InterpretUncachedBlock();
+    return;
+  }
+
+  if (!block->host_code)
+  {
+    if (block->compile_queued || !ShouldCompileBlock(block))
+    {
+      InterpretCachedBlock(*block);
+      return;
+    }
+
+    // The block keeps running in the interpreter until the compile thread is done with it.
+    if (g_settings.cpu_recompiler_thread)
+    {
+      block->compile_queued = true;
+      Recompiler::CompileThread::QueueBlock(block);
+      InterpretCachedBlock(*block);
+      return;
+    }
+
+    Common::Timer timer;
+    EnsureCodeSpace(block->num_instructions);
+    if (!CompileHostCode(block))
+    {
+      block->execution_count = 0;
+      InterpretCachedBlock(*block);
+      return;
+    }
+
+    if (block->profile)
+      block->profile->compile_time_ms += static_cast<float>(timer.GetTimeMilliseconds());
+
+    Log_DebugPrintf("Compiled hot block at 0x%08X after %u executions", block->GetPC(), block->execution_count);
+    SetFastMap(block->GetPC(), block->host_code);
+  }
+
+  block->host_code();
+}
+
+void LinkPendingBlock()
+{
+  CodeBlock* from = g_link_pending_block;
+  g_link_pending_block = nullptr;
+
+  // The exits would never be patched while profiling, so the block would be linked again on every exit.
+  if (from->invalidated || s_profiling)
+    return;
+
+  // Only link to blocks which are already compiled, we don't want to compile (and possibly flush) from here.
+  CodeBlock* to = FindBlock(GetNextBlockKey());
+  if (to && to->num_instructions > 0 && !to->invalidated && to->host_code)
+    LinkBlock(from, to);
+}
+
+void PatchBlockExits(CodeBlock* from, u32 pc, CodeBlock::HostCodePointer code)
+{
+  for (const BlockExitLinkInfo& eli : from->exit_link_info)
+  {
+    if (eli.guest_pc == pc)
+      Recompiler::CodeGenerator::BackpatchBranch(eli.host_pc, code ? reinterpret_cast<const void*>(code) :
+                                                                      eli.host_unlinked_pc);
+  }
 }
 
 #endif
@@ -482,8 +1513,14 @@ void InvalidateBlocksWithPageIndex(u32 page_index)
     // Invalidate forces the block to be checked again.
     Log_DebugPrintf("Invalidating block at 0x%08X", block->GetPC());
     block->invalidated = true;
+    if (block->profile)
+      block->profile->invalidation_count++;
 #ifdef WITH_RECOMPILER
     SetFastMap(block->GetPC(), FastCompileBlockFunction);
+
+    // Linked blocks jump straight to the host code, so they have to be pointed back at the dispatcher.
+    if (s_use_recompiler)
+      UnlinkBlock(block);
 #endif
   }
 
@@ -494,22 +1531,63 @@ void InvalidateBlocksWithPageIndex(u32 page_index)
 
 void FlushBlock(CodeBlock* block)
 {
-  BlockMap::iterator iter = s_blocks.find(block->key.GetPC());
-  Assert(iter != s_blocks.end() && iter->second == block);
   Log_DevPrintf("Flushing block at address 0x%08X", block->GetPC());
 
 #ifdef WITH_RECOMPILER
   SetFastMap(block->GetPC(), FastCompileBlockFunction);
+  if (block->compile_queued)
+  {
+    Recompiler::CompileThread::CancelBlock(block);
+    block->compile_queued = false;
+  }
 #endif
 
   // if it's been invalidated it won't be in the page map
-  if (block->invalidated)
+  if (!block->invalidated)
     RemoveBlockFromPageMap(block);
 
   UnlinkBlock(block);
 
-  s_blocks.erase(iter);
-  delete block;
+#ifdef WITH_RECOMPILER
+  if (block->host_code)
+    RemoveBlockFromHostCodeMap(block);
+#endif
+
+  // The block's memory is reclaimed on the next flush.
+  CodeBlock** link = &s_block_table[GetFastMapIndex(block->GetPC())];
+  while (*link != block)
+  {
+    Assert(*link);
+    link = &(*link)->next_in_slot;
+  }
+  *link = block->next_in_slot;
+  block->next_in_slot = nullptr;
+}
+
+/// Calls callback for each page the block's code is in. Superblocks can be spread over pages which aren't adjacent.
+template<typename T>
+static void EnumerateBlockPages(const CodeBlock* block, T callback)
+{
+  u32 start_page = block->GetStartPageIndex();
+  u32 end_page = start_page;
+  for (u32 i = 1; i < block->num_instructions; i++)
+  {
+    const u32 page = (block->instructions[i].pc & PHYSICAL_MEMORY_ADDRESS_MASK) / CPU_CODE_CACHE_PAGE_SIZE;
+    if (page == end_page || page == (end_page + 1))
+    {
+      end_page = page;
+      continue;
+    }
+
+    for (u32 run_page = start_page; run_page <= end_page; run_page++)
+      callback(run_page);
+
+    start_page = page;
+    end_page = page;
+  }
+
+  for (u32 run_page = start_page; run_page <= end_page; run_page++)
+    callback(run_page);
 }
 
 void AddBlockToPageMap(CodeBlock* block)
@@ -517,13 +1595,13 @@ void AddBlockToPageMap(CodeBlock* block)
   if (!block->IsInRAM())
     return;
 
-  const u32 start_page = block->GetStartPageIndex();
-  const u32 end_page = block->GetEndPageIndex();
-  for (u32 page = start_page; page <= end_page; page++)
-  {
+  EnumerateBlockPages(block, [block](u32 page) {
     m_ram_block_map[page].push_back(block);
     Bus::SetRAMCodePage(page);
-  }
+  });
+
+  for (u32 i = 0; i < block->num_instructions; i++)
+    Bus::SetRAMCodeRange(block->instructions[i].pc & PHYSICAL_MEMORY_ADDRESS_MASK);
 }
 
 void RemoveBlockFromPageMap(CodeBlock* block)
@@ -531,15 +1609,12 @@ void RemoveBlockFromPageMap(CodeBlock* block)
   if (!block->IsInRAM())
     return;
 
-  const u32 start_page = block->GetStartPageIndex();
-  const u32 end_page = block->GetEndPageIndex();
-  for (u32 page = start_page; page <= end_page; page++)
-  {
+  EnumerateBlockPages(block, [block](u32 page) {
     auto& page_blocks = m_ram_block_map[page];
     auto page_block_iter = std::find(page_blocks.begin(), page_blocks.end(), block);
     Assert(page_block_iter != page_blocks.end());
     page_blocks.erase(page_block_iter);
-  }
+  });
 }
 
 void LinkBlock(CodeBlock* from, CodeBlock* to)
@@ -547,6 +1622,12 @@ void LinkBlock(CodeBlock* from, CodeBlock* to)
   Log_DebugPrintf("Linking block %p(%08x) to %p(%08x)", from, from->GetPC(), to, to->GetPC());
   from->link_successors.push_back(to);
   to->link_predecessors.push_back(from);
+
+#ifdef WITH_RECOMPILER
+  // Linked host code doesn't go back through the dispatcher, so the profile wouldn't see the successor.
+  if (!s_profiling)
+    PatchBlockExits(from, to->GetPC(), to->host_code);
+#endif
 }
 
 void UnlinkBlock(CodeBlock* block)
@@ -556,6 +1637,9 @@ void UnlinkBlock(CodeBlock* block)
     auto iter = std::find(predecessor->link_successors.begin(), predecessor->link_successors.end(), block);
     Assert(iter != predecessor->link_successors.end());
     predecessor->link_successors.erase(iter);
+#ifdef WITH_RECOMPILER
+    PatchBlockExits(predecessor, block->GetPC(), nullptr);
+#endif
   }
   block->link_predecessors.clear();
 
@@ -564,8 +1648,78 @@ void UnlinkBlock(CodeBlock* block)
     auto iter = std::find(successor->link_predecessors.begin(), successor->link_predecessors.end(), block);
     Assert(iter != successor->link_predecessors.end());
     successor->link_predecessors.erase(iter);
+#ifdef WITH_RECOMPILER
+    PatchBlockExits(block, successor->GetPC(), nullptr);
+#endif
   }
   block->link_successors.clear();
 }
 
+#ifdef WITH_RECOMPILER
+
+void AddBlockToHostCodeMap(CodeBlock* block)
+{
+  s_host_code_map.emplace(block->host_code, block);
+  if (block->profile)
+    block->profile->host_code_size = block->host_code_size;
+}
+
+void RemoveBlockFromHostCodeMap(CodeBlock* block)
+{
+  HostCodeMap::iterator hc_iter = s_host_code_map.find(block->host_code);
+  Assert(hc_iter != s_host_code_map.end());
+  s_host_code_map.erase(hc_iter);
+}
+
+Common::PageFaultHandler::HandlerResult PageFaultHandler(void* exception_pc, void* fault_address, bool is_write)
+{
+  // Writes to protected code pages can come from anywhere, not just recompiled code.
+  if (is_write && Bus::HandleCodePageWriteFault(fault_address))
+    return Common::PageFaultHandler::HandlerResult::ContinueExecution;
+
+  if (!Bus::IsFastmemAddress(fault_address))
+    return Common::PageFaultHandler::HandlerResult::ExecuteNextHandler;
+
+  Log_DevPrintf("Page fault handler invoked at PC=%p Address=%p %s", exception_pc, fault_address,
+                is_write ? "(write)" : "(read)");
+
+  // use upper_bound to find the next block after the pc
+  HostCodeMap::iterator iter =
+    s_host_code_map.upper_bound(reinterpret_cast<CodeBlock::HostCodePointer>(exception_pc));
+  if (iter == s_host_code_map.begin())
+    return Common::PageFaultHandler::HandlerResult::ExecuteNextHandler;
+
+  // then decrement it by one to (hopefully) get the block we want
+  --iter;
+
+  // find the loadstore info in the code
+  CodeBlock* block = iter->second;
+  for (auto bpi_iter = block->loadstore_backpatch_info.begin(); bpi_iter != block->loadstore_backpatch_info.end();
+       ++bpi_iter)
+  {
+    const LoadStoreBackpatchInfo& lbi = *bpi_iter;
+    if (lbi.host_pc == exception_pc)
+    {
+      // found it, do fixup
+      if (Recompiler::CodeGenerator::BackpatchLoadStore(lbi))
+      {
+        // remove the backpatch entry since we won't be coming back to this one
+        block->loadstore_backpatch_info.erase(bpi_iter);
+        return Common::PageFaultHandler::HandlerResult::ContinueExecution;
+      }
+      else
+      {
+        Log_ErrorPrintf("Failed to backpatch %p in block 0x%08X", exception_pc, block->GetPC());
+        return Common::PageFaultHandler::HandlerResult::ExecuteNextHandler;
+      }
+    }
+  }
+
+  // we didn't find the pc in our list..
+  Log_ErrorPrintf("Loadstore PC not found for %p in block 0x%08X", exception_pc, block->GetPC());
+  return Common::PageFaultHandler::HandlerResult::ExecuteNextHandler;
+}
+
+#endif
+
 } // namespace CPU::CodeCache
@@ -4,9 +4,12 @@
 #include "cpu_types.h"
 #include <array>
 #include <memory>
-#include <unordered_map>
 #include <vector>
 
+namespace BIOS {
+struct Hash;
+}
+
 namespace CPU {
 
 union CodeBlockKey
@@ -32,6 +35,11 @@ union CodeBlockKey
   ALWAYS_INLINE bool operator<(const CodeBlockKey& rhs) const { return bits < rhs.bits; }
 };
 
+struct CodeBlockInstruction;
+
+/// Executes a pre-decoded instruction in the cached interpreter.
+using InterpreterHandler = void (*)(const CodeBlockInstruction& cbi);
+
 struct CodeBlockInstruction
 {
   Instruction instruction;
@@ -45,31 +53,112 @@ struct CodeBlockInstruction
   bool is_last_instruction : 1;
   bool has_load_delay : 1;
   bool can_trap : 1;
+
+  // pre-decoded operands for the cached interpreter, see CodeCache::PredecodeInstruction()
+  Reg rs;
+  Reg rt;
+  Reg rd;
+  u8 shamt;
+  u32 imm; // extended immediate, or the target of direct branches
+  InterpreterHandler handler;
+};
+
+struct LoadStoreBackpatchInfo
+{
+  void* host_pc;         // pointer to instruction which will fault
+  void* host_slowmem_pc; // pointer to slowmem callback code
+  u32 host_code_size;    // size of the fastmem load/store, including padding
+  u32 guest_pc;          // guest pc of the load/store, for debugging
+};
+
+struct BlockExitLinkInfo
+{
+  void* host_pc;          // pointer to the patchable jump
+  void* host_unlinked_pc; // pointer to the code which returns to the dispatcher
+  u32 guest_pc;           // guest pc of the successor block
+};
+
+/// Counters for a block which are gathered while the code cache profile is shown. They're kept by the block's key
+/// rather than in the block, so they carry over when the block is flushed or recompiled.
+struct CodeBlockProfile
+{
+  u64 execution_count;
+  u64 ticks;
+  u32 num_instructions;
+  u32 host_code_size;
+  u32 invalidation_count;
+  float compile_time_ms;
 };
 
 struct CodeBlock
 {
   using HostCodePointer = void (*)();
 
-  CodeBlock(const CodeBlockKey key_) : key(key_) {}
-
-  CodeBlockKey key;
+  CodeBlockKey key = {};
   u32 host_code_size = 0;
   HostCodePointer host_code = nullptr;
 
-  std::vector<CodeBlockInstruction> instructions;
+  // decoded instructions, allocated from the code cache's instruction arena
+  CodeBlockInstruction* instructions = nullptr;
+  u32 num_instructions = 0;
+
+  // hash of the guest code the instructions were decoded from, checked first when the block is revalidated
+  u64 code_hash = 0;
+
+  // next block which shares the same lookup table slot
+  CodeBlock* next_in_slot = nullptr;
+
   std::vector<CodeBlock*> link_predecessors;
   std::vector<CodeBlock*> link_successors;
 
+  // fastmem accesses which can be backpatched to slowmem on fault
+  std::vector<LoadStoreBackpatchInfo> loadstore_backpatch_info;
+
+  // exits to statically-known successors, which can be patched to jump directly to the successor's code
+  std::vector<BlockExitLinkInfo> exit_link_info;
+
+  // number of times the block has been interpreted, used to decide when to compile it in tiered mode
+  u32 execution_count = 0;
+
+  // number of times the block's code changed and it had to be decoded again
+  u32 recompile_count = 0;
+
   bool invalidated = false;
 
-  const u32 GetPC() const { return key.GetPC(); }
-  const u32 GetSizeInBytes() const { return static_cast<u32>(instructions.size()) * sizeof(Instruction); }
-  const u32 GetStartPageIndex() const { return (key.GetPCPhysicalAddress() / CPU_CODE_CACHE_PAGE_SIZE); }
-  const u32 GetEndPageIndex() const
+  // waiting to be compiled on the compile thread, which owns the backpatch and exit link info until it's done
+  bool compile_queued = false;
+
+  // loops back to itself without side effects, so it can skip ahead to the next event
+  bool idle_loop = false;
+
+  // null unless the block was created while profiling
+  CodeBlockProfile* profile = nullptr;
+
+  /// Reinitializes a recycled block. The vectors keep their storage, so reusing a block does not allocate.
+  void Reset(const CodeBlockKey key_)
   {
-    return ((key.GetPCPhysicalAddress() + GetSizeInBytes()) / CPU_CODE_CACHE_PAGE_SIZE);
+    key = key_;
+    host_code_size = 0;
+    host_code = nullptr;
+    instructions = nullptr;
+    num_instructions = 0;
+    code_hash = 0;
+    next_in_slot = nullptr;
+    link_predecessors.clear();
+    link_successors.clear();
+    loadstore_backpatch_info.clear();
+    exit_link_info.clear();
+    execution_count = 0;
+    recompile_count = 0;
+    invalidated = false;
+    compile_queued = false;
+    idle_loop = false;
+    profile = nullptr;
   }
+
+  const u32 GetPC() const { return key.GetPC(); }
+  const u32 GetSizeInBytes() const { return num_instructions * sizeof(Instruction); }
+  const u32 GetStartPageIndex() const { return (key.GetPCPhysicalAddress() / CPU_CODE_CACHE_PAGE_SIZE); }
   bool IsInRAM() const
   {
     // TODO: Constant
@@ -79,23 +168,57 @@ struct CodeBlock
 
 namespace CodeCache {
 
+struct Statistics
+{
+  u32 num_revalidations;   // invalidated blocks which were checked before executing them again
+  u32 num_hash_mismatches; // revalidations which had to compare every instruction
+  u32 num_recompiles;      // revalidations which found the code had changed
+};
+
 void Initialize(bool use_recompiler);
 void Shutdown();
 void Execute();
 
 #ifdef WITH_RECOMPILER
 void ExecuteRecompiler();
+
+/// Set by an unlinked block exit, so the dispatcher can link the block to its successor.
+extern CodeBlock* g_link_pending_block;
 #endif
 
 /// Flushes the code cache, forcing all blocks to be recompiled.
 void Flush();
 
+/// Returns the counters since the code cache was initialized.
+const Statistics& GetStatistics();
+
+/// Clears the per-block profile counters.
+void ResetProfile();
+
+/// Writes the profiled blocks to a text file, most expensive first.
+bool WriteProfileReport(const char* filename);
+
+/// Shows the profiled blocks in an ImGui window.
+void DrawProfileWindow();
+
 /// Changes whether the recompiler is enabled.
 void SetUseRecompiler(bool enable);
 
+/// Returns true if fastmem can be used by the recompiler on this host.
+bool IsUsingFastmem();
+
+/// Returns true if writes to code are detected by write-protecting RAM pages, instead of checking every store.
+bool IsUsingCodePageProtection();
+
+/// Loads previously recompiled code for the specified BIOS from disk, if enabled.
+void OpenDiskCache(const BIOS::Hash& bios_hash);
+
 /// Invalidates all blocks which are in the range of the specified code page.
 void InvalidateBlocksWithPageIndex(u32 page_index);
 
+/// Picks the interpreter handler for the instruction, and extracts its operands.
+void PredecodeInstruction(CodeBlockInstruction* cbi);
+
 void InterpretCachedBlock(const CodeBlock& block);
 void InterpretUncachedBlock();
 
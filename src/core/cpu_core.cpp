@@ -1,8 +1,10 @@
 #include "cpu_core.h"
+#include "bus.h"
 #include "common/align.h"
 #include "common/file_system.h"
 #include "common/log.h"
 #include "common/state_wrapper.h"
+#include "cpu_code_cache.h"
 #include "cpu_core_private.h"
 #include "cpu_disasm.h"
 #include "cpu_recompiler_thunks.h"
@@ -10,6 +12,7 @@
 #include "pgxp.h"
 #include "settings.h"
 #include "timing_event.h"
+#include <algorithm>
 #include <cstdio>
 Log_SetChannel(CPU::Core);
 
@@ -71,6 +74,7 @@ void Initialize()
 void Shutdown()
 {
   // GTE::Shutdown();
+  PGXP::Shutdown();
 }
 
 void Reset()
@@ -96,6 +100,8 @@ void Reset()
 
   if (g_settings.gpu_pgxp_enable)
     PGXP::Initialize();
+
+  UpdateFastmemMapping();
 }
 
 bool DoState(StateWrapper& sw)
@@ -134,11 +140,21 @@ bool DoState(StateWrapper& sw)
     return false;
 
   if (sw.IsReading())
-    PGXP::Initialize();
+  {
+    if (g_settings.gpu_pgxp_enable)
+      PGXP::Initialize();
+
+    UpdateFastmemMapping();
+  }
 
   return !sw.HasError();
 }
 
+void UpdateFastmemMapping()
+{
+  g_state.fastmem_base = Bus::UpdateFastmemViews(CodeCache::IsUsingFastmem(), g_state.cop0_regs.sr.Isc);
+}
+
 void SetPC(u32 new_pc)
 {
   DebugAssert(Common::IsAlignedPow2(new_pc, 4));
@@ -233,6 +249,9 @@ void SetExternalInterrupt(u8 bit)
 {
   g_state.cop0_regs.cause.Ip |= static_cast<u8>(1u << bit);
   g_state.interrupt_delay = 1;
+
+  // Linked blocks only return to the dispatcher at the end of the slice, so end it early to check the interrupt.
+  g_state.downcount = 0;
 }
 
 void ClearExternalInterrupt(u8 bit)
@@ -395,9 +414,12 @@ static void WriteCop0Reg(Cop0Reg reg, u32 value)
 
     case Cop0Reg::SR:
     {
+      const bool old_isc = g_state.cop0_regs.sr.Isc;
       g_state.cop0_regs.sr.bits =
         (g_state.cop0_regs.sr.bits & ~Cop0Registers::SR::WRITE_MASK) | (value & Cop0Registers::SR::WRITE_MASK);
       Log_DebugPrintf("COP0 SR <- %08X (now %08X)", value, g_state.cop0_regs.sr.bits);
+      if (g_state.cop0_regs.sr.Isc != old_isc && g_state.fastmem_base)
+        UpdateFastmemMapping();
     }
     break;
 
@@ -1303,6 +1325,440 @@ void ExecuteCop2Instruction()
 
 namespace CodeCache {
 
+// Handlers for pre-decoded instructions. These behave the same as ExecuteInstruction(), but the operands were extracted
+// when the block was decoded, and the targets of direct branches are already known. Anything uncommon goes through
+// ExecuteInstruction() instead.
+
+static void InterpretFallback(const CodeBlockInstruction& cbi)
+{
+  ExecuteInstruction();
+}
+
+template<InstructionFunct funct>
+static void InterpretRegisterOp(const CodeBlockInstruction& cbi)
+{
+  const u32 lhs = ReadReg(cbi.rs);
+  const u32 rhs = ReadReg(cbi.rt);
+  u32 new_value;
+  if constexpr (funct == InstructionFunct::sll)
+    new_value = rhs << cbi.shamt;
+  else if constexpr (funct == InstructionFunct::srl)
+    new_value = rhs >> cbi.shamt;
+  else if constexpr (funct == InstructionFunct::sra)
+    new_value = static_cast<u32>(static_cast<s32>(rhs) >> cbi.shamt);
+  else if constexpr (funct == InstructionFunct::sllv)
+    new_value = rhs << (lhs & UINT32_C(0x1F));
+  else if constexpr (funct == InstructionFunct::srlv)
+    new_value = rhs >> (lhs & UINT32_C(0x1F));
+  else if constexpr (funct == InstructionFunct::srav)
+    new_value = static_cast<u32>(static_cast<s32>(rhs) >> (lhs & UINT32_C(0x1F)));
+  else if constexpr (funct == InstructionFunct::and_)
+    new_value = lhs & rhs;
+  else if constexpr (funct == InstructionFunct::or_)
+    new_value = lhs | rhs;
+  else if constexpr (funct == InstructionFunct::xor_)
+    new_value = lhs ^ rhs;
+  else if constexpr (funct == InstructionFunct::nor)
+    new_value = ~(lhs | rhs);
+  else if constexpr (funct == InstructionFunct::addu)
+    new_value = lhs + rhs;
+  else if constexpr (funct == InstructionFunct::subu)
+    new_value = lhs - rhs;
+  else if constexpr (funct == InstructionFunct::slt)
+    new_value = BoolToUInt32(static_cast<s32>(lhs) < static_cast<s32>(rhs));
+  else if constexpr (funct == InstructionFunct::sltu)
+    new_value = BoolToUInt32(lhs < rhs);
+  else if constexpr (funct == InstructionFunct::add || funct == InstructionFunct::sub)
+  {
+    new_value = (funct == InstructionFunct::add) ? (lhs + rhs) : (lhs - rhs);
+    if ((funct == InstructionFunct::add) ? AddOverflow(lhs, rhs, new_value) : SubOverflow(lhs, rhs, new_value))
+    {
+      RaiseException(Exception::Ov);
+      return;
+    }
+  }
+
+  WriteReg(cbi.rd, new_value);
+}
+
+template<InstructionFunct funct>
+static void InterpretMultiplyDivide(const CodeBlockInstruction& cbi)
+{
+  const u32 lhs = ReadReg(cbi.rs);
+  const u32 rhs = ReadReg(cbi.rt);
+  if constexpr (funct == InstructionFunct::mult || funct == InstructionFunct::multu)
+  {
+    const u64 result = (funct == InstructionFunct::mult) ?
+                         static_cast<u64>(static_cast<s64>(SignExtend64(lhs)) * static_cast<s64>(SignExtend64(rhs))) :
+                         (ZeroExtend64(lhs) * ZeroExtend64(rhs));
+    g_state.regs.hi = Truncate32(result >> 32);
+    g_state.regs.lo = Truncate32(result);
+  }
+  else if constexpr (funct == InstructionFunct::div)
+  {
+    const s32 num = static_cast<s32>(lhs);
+    const s32 denom = static_cast<s32>(rhs);
+    if (denom == 0)
+    {
+      g_state.regs.lo = (num >= 0) ? UINT32_C(0xFFFFFFFF) : UINT32_C(1);
+      g_state.regs.hi = static_cast<u32>(num);
+    }
+    else if (static_cast<u32>(num) == UINT32_C(0x80000000) && denom == -1)
+    {
+      g_state.regs.lo = UINT32_C(0x80000000);
+      g_state.regs.hi = 0;
+    }
+    else
+    {
+      g_state.regs.lo = static_cast<u32>(num / denom);
+      g_state.regs.hi = static_cast<u32>(num % denom);
+    }
+  }
+  else if constexpr (funct == InstructionFunct::divu)
+  {
+    if (rhs == 0)
+    {
+      g_state.regs.lo = UINT32_C(0xFFFFFFFF);
+      g_state.regs.hi = lhs;
+    }
+    else
+    {
+      g_state.regs.lo = lhs / rhs;
+      g_state.regs.hi = lhs % rhs;
+    }
+  }
+}
+
+template<InstructionFunct funct>
+static void InterpretHiLoMove(const CodeBlockInstruction& cbi)
+{
+  if constexpr (funct == InstructionFunct::mfhi)
+    WriteReg(cbi.rd, g_state.regs.hi);
+  else if constexpr (funct == InstructionFunct::mflo)
+    WriteReg(cbi.rd, g_state.regs.lo);
+  else if constexpr (funct == InstructionFunct::mthi)
+    g_state.regs.hi = ReadReg(cbi.rs);
+  else if constexpr (funct == InstructionFunct::mtlo)
+    g_state.regs.lo = ReadReg(cbi.rs);
+}
+
+template<InstructionOp op>
+static void InterpretImmediateOp(const CodeBlockInstruction& cbi)
+{
+  const u32 lhs = ReadReg(cbi.rs);
+  u32 new_value;
+  if constexpr (op == InstructionOp::lui)
+    new_value = cbi.imm;
+  else if constexpr (op == InstructionOp::andi)
+    new_value = lhs & cbi.imm;
+  else if constexpr (op == InstructionOp::ori)
+    new_value = lhs | cbi.imm;
+  else if constexpr (op == InstructionOp::xori)
+    new_value = lhs ^ cbi.imm;
+  else if constexpr (op == InstructionOp::addiu)
+    new_value = lhs + cbi.imm;
+  else if constexpr (op == InstructionOp::slti)
+    new_value = BoolToUInt32(static_cast<s32>(lhs) < static_cast<s32>(cbi.imm));
+  else if constexpr (op == InstructionOp::sltiu)
+    new_value = BoolToUInt32(lhs < cbi.imm);
+  else if constexpr (op == InstructionOp::addi)
+  {
+    new_value = lhs + cbi.imm;
+    if (AddOverflow(lhs, cbi.imm, new_value))
+    {
+      RaiseException(Exception::Ov);
+      return;
+    }
+  }
+
+  WriteReg(cbi.rt, new_value);
+}
+
+template<InstructionOp op>
+static void InterpretLoad(const CodeBlockInstruction& cbi)
+{
+  const VirtualMemoryAddress addr = ReadReg(cbi.rs) + cbi.imm;
+  u32 value;
+  if constexpr (op == InstructionOp::lb || op == InstructionOp::lbu)
+  {
+    u8 byte_value;
+    if (!ReadMemoryByte(addr, &byte_value))
+      return;
+
+    value = (op == InstructionOp::lb) ? SignExtend32(byte_value) : ZeroExtend32(byte_value);
+  }
+  else if constexpr (op == InstructionOp::lh || op == InstructionOp::lhu)
+  {
+    u16 halfword_value;
+    if (!ReadMemoryHalfWord(addr, &halfword_value))
+      return;
+
+    value = (op == InstructionOp::lh) ? SignExtend32(halfword_value) : ZeroExtend32(halfword_value);
+  }
+  else
+  {
+    if (!ReadMemoryWord(addr, &value))
+      return;
+  }
+
+  WriteRegDelayed(cbi.rt, value);
+
+  if (g_settings.gpu_pgxp_enable)
+  {
+    if constexpr (op == InstructionOp::lb || op == InstructionOp::lbu)
+      PGXP::CPU_LBx(cbi.instruction.bits, value, addr);
+    else if constexpr (op == InstructionOp::lh || op == InstructionOp::lhu)
+      PGXP::CPU_LHx(cbi.instruction.bits, value, addr);
+    else
+      PGXP::CPU_LW(cbi.instruction.bits, value, addr);
+  }
+}
+
+template<InstructionOp op>
+static void InterpretStore(const CodeBlockInstruction& cbi)
+{
+  const VirtualMemoryAddress addr = ReadReg(cbi.rs) + cbi.imm;
+  const u32 value = ReadReg(cbi.rt);
+  if constexpr (op == InstructionOp::sb)
+  {
+    WriteMemoryByte(addr, Truncate8(value));
+    if (g_settings.gpu_pgxp_enable)
+      PGXP::CPU_SB(cbi.instruction.bits, Truncate8(value), addr);
+  }
+  else if constexpr (op == InstructionOp::sh)
+  {
+    WriteMemoryHalfWord(addr, Truncate16(value));
+    if (g_settings.gpu_pgxp_enable)
+      PGXP::CPU_SH(cbi.instruction.bits, Truncate16(value), addr);
+  }
+  else
+  {
+    WriteMemoryWord(addr, value);
+    if (g_settings.gpu_pgxp_enable)
+      PGXP::CPU_SW(cbi.instruction.bits, value, addr);
+  }
+}
+
+template<InstructionOp op>
+static void InterpretBranch(const CodeBlockInstruction& cbi)
+{
+  // We're still flagged as a branch delay slot even if the branch isn't taken.
+  g_state.next_instruction_is_branch_delay_slot = true;
+
+  bool branch;
+  if constexpr (op == InstructionOp::j)
+  {
+    branch = true;
+  }
+  else if constexpr (op == InstructionOp::jal)
+  {
+    WriteReg(Reg::ra, g_state.regs.npc);
+    branch = true;
+  }
+  else if constexpr (op == InstructionOp::beq)
+  {
+    branch = (ReadReg(cbi.rs) == ReadReg(cbi.rt));
+  }
+  else if constexpr (op == InstructionOp::bne)
+  {
+    branch = (ReadReg(cbi.rs) != ReadReg(cbi.rt));
+  }
+  else if constexpr (op == InstructionOp::bgtz)
+  {
+    branch = (static_cast<s32>(ReadReg(cbi.rs)) > 0);
+  }
+  else if constexpr (op == InstructionOp::blez)
+  {
+    branch = (static_cast<s32>(ReadReg(cbi.rs)) <= 0);
+  }
+  else if constexpr (op == InstructionOp::b)
+  {
+    // rt holds the raw condition bits, see ExecuteInstruction()
+    const u8 rt = static_cast<u8>(cbi.rt);
+    const bool bgez = ConvertToBoolUnchecked(rt & u8(1));
+    branch = (static_cast<s32>(ReadReg(cbi.rs)) < 0) ^ bgez;
+    if ((rt & u8(0x1E)) == u8(0x10))
+      WriteReg(Reg::ra, g_state.regs.npc);
+  }
+
+  // direct branch targets are always aligned, so they can't raise an exception
+  if (branch)
+  {
+    g_state.regs.npc = cbi.imm;
+    g_state.branch_was_taken = true;
+  }
+}
+
+template<InstructionFunct funct>
+static void InterpretIndirectBranch(const CodeBlockInstruction& cbi)
+{
+  g_state.next_instruction_is_branch_delay_slot = true;
+  const u32 target = ReadReg(cbi.rs);
+  if constexpr (funct == InstructionFunct::jalr)
+    WriteReg(cbi.rd, g_state.regs.npc);
+
+  Branch(target);
+}
+
+static InterpreterHandler GetFunctHandler(InstructionFunct funct)
+{
+  switch (funct)
+  {
+    case InstructionFunct::sll:
+      return InterpretRegisterOp<InstructionFunct::sll>;
+    case InstructionFunct::srl:
+      return InterpretRegisterOp<InstructionFunct::srl>;
+    case InstructionFunct::sra:
+      return InterpretRegisterOp<InstructionFunct::sra>;
+    case InstructionFunct::sllv:
+      return InterpretRegisterOp<InstructionFunct::sllv>;
+    case InstructionFunct::srlv:
+      return InterpretRegisterOp<InstructionFunct::srlv>;
+    case InstructionFunct::srav:
+      return InterpretRegisterOp<InstructionFunct::srav>;
+    case InstructionFunct::and_:
+      return InterpretRegisterOp<InstructionFunct::and_>;
+    case InstructionFunct::or_:
+      return InterpretRegisterOp<InstructionFunct::or_>;
+    case InstructionFunct::xor_:
+      return InterpretRegisterOp<InstructionFunct::xor_>;
+    case InstructionFunct::nor:
+      return InterpretRegisterOp<InstructionFunct::nor>;
+    case InstructionFunct::add:
+      return InterpretRegisterOp<InstructionFunct::add>;
+    case InstructionFunct::addu:
+      return InterpretRegisterOp<InstructionFunct::addu>;
+    case InstructionFunct::sub:
+      return InterpretRegisterOp<InstructionFunct::sub>;
+    case InstructionFunct::subu:
+      return InterpretRegisterOp<InstructionFunct::subu>;
+    case InstructionFunct::slt:
+      return InterpretRegisterOp<InstructionFunct::slt>;
+    case InstructionFunct::sltu:
+      return InterpretRegisterOp<InstructionFunct::sltu>;
+    case InstructionFunct::mult:
+      return InterpretMultiplyDivide<InstructionFunct::mult>;
+    case InstructionFunct::multu:
+      return InterpretMultiplyDivide<InstructionFunct::multu>;
+    case InstructionFunct::div:
+      return InterpretMultiplyDivide<InstructionFunct::div>;
+    case InstructionFunct::divu:
+      return InterpretMultiplyDivide<InstructionFunct::divu>;
+    case InstructionFunct::mfhi:
+      return InterpretHiLoMove<InstructionFunct::mfhi>;
+    case InstructionFunct::mthi:
+      return InterpretHiLoMove<InstructionFunct::mthi>;
+    case InstructionFunct::mflo:
+      return InterpretHiLoMove<InstructionFunct::mflo>;
+    case InstructionFunct::mtlo:
+      return InterpretHiLoMove<InstructionFunct::mtlo>;
+    case InstructionFunct::jr:
+      return InterpretIndirectBranch<InstructionFunct::jr>;
+    case InstructionFunct::jalr:
+      return InterpretIndirectBranch<InstructionFunct::jalr>;
+    default:
+      return InterpretFallback;
+  }
+}
+
+static InterpreterHandler GetOpHandler(InstructionOp op)
+{
+  switch (op)
+  {
+    case InstructionOp::lui:
+      return InterpretImmediateOp<InstructionOp::lui>;
+    case InstructionOp::andi:
+      return InterpretImmediateOp<InstructionOp::andi>;
+    case InstructionOp::ori:
+      return InterpretImmediateOp<InstructionOp::ori>;
+    case InstructionOp::xori:
+      return InterpretImmediateOp<InstructionOp::xori>;
+    case InstructionOp::addi:
+      return InterpretImmediateOp<InstructionOp::addi>;
+    case InstructionOp::addiu:
+      return InterpretImmediateOp<InstructionOp::addiu>;
+    case InstructionOp::slti:
+      return InterpretImmediateOp<InstructionOp::slti>;
+    case InstructionOp::sltiu:
+      return InterpretImmediateOp<InstructionOp::sltiu>;
+    case InstructionOp::lb:
+      return InterpretLoad<InstructionOp::lb>;
+    case InstructionOp::lbu:
+      return InterpretLoad<InstructionOp::lbu>;
+    case InstructionOp::lh:
+      return InterpretLoad<InstructionOp::lh>;
+    case InstructionOp::lhu:
+      return InterpretLoad<InstructionOp::lhu>;
+    case InstructionOp::lw:
+      return InterpretLoad<InstructionOp::lw>;
+    case InstructionOp::sb:
+      return InterpretStore<InstructionOp::sb>;
+    case InstructionOp::sh:
+      return InterpretStore<InstructionOp::sh>;
+    case InstructionOp::sw:
+      return InterpretStore<InstructionOp::sw>;
+    case InstructionOp::j:
+      return InterpretBranch<InstructionOp::j>;
+    case InstructionOp::jal:
+      return InterpretBranch<InstructionOp::jal>;
+    case InstructionOp::beq:
+      return InterpretBranch<InstructionOp::beq>;
+    case InstructionOp::bne:
+      return InterpretBranch<InstructionOp::bne>;
+    case InstructionOp::bgtz:
+      return InterpretBranch<InstructionOp::bgtz>;
+    case InstructionOp::blez:
+      return InterpretBranch<InstructionOp::blez>;
+    case InstructionOp::b:
+      return InterpretBranch<InstructionOp::b>;
+    default:
+      return InterpretFallback;
+  }
+}
+
+void PredecodeInstruction(CodeBlockInstruction* cbi)
+{
+  const Instruction inst = cbi->instruction;
+  cbi->rs = inst.r.rs;
+  cbi->rt = inst.r.rt;
+  cbi->rd = inst.r.rd;
+  cbi->shamt = inst.r.shamt;
+
+  // the pc has already been advanced when the instruction is executed
+  const u32 pc = cbi->pc + 4;
+  switch (inst.op)
+  {
+    case InstructionOp::lui:
+      cbi->imm = inst.i.imm_zext32() << 16;
+      break;
+
+    case InstructionOp::andi:
+    case InstructionOp::ori:
+    case InstructionOp::xori:
+      cbi->imm = inst.i.imm_zext32();
+      break;
+
+    case InstructionOp::j:
+    case InstructionOp::jal:
+      cbi->imm = (pc & UINT32_C(0xF0000000)) | (inst.j.target << 2);
+      break;
+
+    case InstructionOp::beq:
+    case InstructionOp::bne:
+    case InstructionOp::bgtz:
+    case InstructionOp::blez:
+    case InstructionOp::b:
+      cbi->imm = pc + (inst.i.imm_sext32() << 2);
+      break;
+
+    default:
+      cbi->imm = inst.i.imm_sext32();
+      break;
+  }
+
+  cbi->handler = (inst.op == InstructionOp::funct) ? GetFunctHandler(inst.r.funct) : GetOpHandler(inst.op);
+}
+
 void InterpretCachedBlock(const CodeBlock& block)
 {
   // set up the state so we've already fetched the instruction
@@ -1310,8 +1766,10 @@ void InterpretCachedBlock(const CodeBlock& block)
 
   g_state.regs.npc = block.GetPC() + 4;
 
-  for (const CodeBlockInstruction& cbi : block.instructions)
+  for (const CodeBlockInstruction* cbi_ptr = block.instructions; cbi_ptr != block.instructions + block.num_instructions;
+       cbi_ptr++)
   {
+    const CodeBlockInstruction& cbi = *cbi_ptr;
     g_state.pending_ticks++;
 
     // now executing the instruction we previously fetched
@@ -1327,7 +1785,7 @@ void InterpretCachedBlock(const CodeBlock& block)
     g_state.regs.npc += 4;
 
     // execute the instruction we previously fetched
-    ExecuteInstruction();
+    cbi.handler(cbi);
 
     // next load delay
     UpdateLoadDelay();
@@ -1338,6 +1796,10 @@ void InterpretCachedBlock(const CodeBlock& block)
 
   // cleanup so the interpreter can kick in if needed
   g_state.next_instruction_is_branch_delay_slot = false;
+
+  // nothing changes until the next event if an idle loop goes around again
+  if (block.idle_loop && g_state.regs.pc == block.GetPC())
+    g_state.pending_ticks = std::max(g_state.pending_ticks, g_state.downcount);
 }
 
 void InterpretUncachedBlock()
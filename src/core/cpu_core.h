@@ -56,6 +56,9 @@ struct State
 
   // data cache (used as scratchpad)
   std::array<u8, DCACHE_SIZE> dcache = {};
+
+  // base of the host mapping of the guest address space, used by the recompiler's fastmem path
+  u8* fastmem_base = nullptr;
 };
 
 extern State g_state;
@@ -65,6 +68,9 @@ void Shutdown();
 void Reset();
 bool DoState(StateWrapper& sw);
 
+/// Updates the host address space mapping used for fastmem, e.g. after a change of cache isolation.
+void UpdateFastmemMapping();
+
 /// Executes interpreter loop.
 void Execute();
 
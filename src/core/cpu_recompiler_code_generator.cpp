@@ -19,14 +19,19 @@ u32 CodeGenerator::CalculateRegisterOffset(Reg reg)
   return u32(offsetof(State, regs.r[0]) + (static_cast<u32>(reg) * sizeof(u32)));
 }
 
-bool CodeGenerator::CompileBlock(const CodeBlock* block, CodeBlock::HostCodePointer* out_host_code,
-                                 u32* out_host_code_size)
+bool CodeGenerator::CompileBlock(CodeBlock* block, CodeBlock::HostCodePointer* out_host_code, u32* out_host_code_size)
 {
   // TODO: Align code buffer.
 
   m_block = block;
-  m_block_start = block->instructions.data();
-  m_block_end = block->instructions.data() + block->instructions.size();
+  m_block_start = block->instructions;
+  m_block_end = block->instructions + block->num_instructions;
+  m_block_exit_pc_count = 0;
+  m_block_can_link = true;
+  m_relocations.clear();
+  m_block_cacheable = true;
+
+  AnalyzeBlock();
 
   EmitBeginBlock();
   BlockPrologue();
@@ -34,13 +39,21 @@ bool CodeGenerator::CompileBlock(const CodeBlock* block, CodeBlock::HostCodePoin
   const CodeBlockInstruction* cbi = m_block_start;
   while (cbi != m_block_end)
   {
+    const bool is_dead = m_dead_instructions[cbi - m_block_start];
+
 #ifndef Y_BUILD_CONFIG_RELEASE
     SmallString disasm;
     DisassembleInstruction(&disasm, cbi->pc, cbi->instruction.bits, nullptr);
-    Log_DebugPrintf("Compiling instruction '%s'", disasm.GetCharArray());
+    Log_DebugPrintf("Compiling instruction '%s'%s", disasm.GetCharArray(), is_dead ? " (dead)" : "");
 #endif
 
-    if (!CompileInstruction(*cbi))
+    // Superblocks continue at the target of a branch. The pc was already updated by the branch, but the offsets for the
+    // current instruction pc restart from zero after the delay slot. This applies even when the target directly follows
+    // the delay slot, since the stored pc is still the one from the start of the block.
+    if (cbi != m_block_start && (cbi - 1)->is_branch_delay_slot)
+      EmitStoreCPUStructField(offsetof(State, current_instruction_pc), Value::FromConstantU32(cbi->pc));
+
+    if (!(is_dead ? Compile_DeadWrite(*cbi) : CompileInstruction(*cbi)))
     {
       m_block_end = nullptr;
       m_block_start = nullptr;
@@ -55,8 +68,8 @@ bool CodeGenerator::CompileBlock(const CodeBlock* block, CodeBlock::HostCodePoin
   EmitEndBlock();
 
   FinalizeBlock(out_host_code, out_host_code_size);
-  Log_ProfilePrintf("JIT block 0x%08X: %zu instructions (%u bytes), %u host bytes", block->GetPC(),
-                    block->instructions.size(), block->GetSizeInBytes(), *out_host_code_size);
+  Log_ProfilePrintf("JIT block 0x%08X: %u instructions (%u bytes), %u host bytes", block->GetPC(),
+                    block->num_instructions, block->GetSizeInBytes(), *out_host_code_size);
 
   DebugAssert(m_register_cache.GetUsedHostRegisters() == 0);
 
@@ -66,6 +79,119 @@ bool CodeGenerator::CompileBlock(const CodeBlock* block, CodeBlock::HostCodePoin
   return true;
 }
 
+/// Returns true if the instruction only computes a value into a register, i.e. it can't raise an exception or have any
+/// other side effects, and can be skipped if the value is never read. Unused sources are set to the zero register.
+static bool GetPureInstructionRegisters(const Instruction& instruction, Reg* dest, Reg* src1, Reg* src2)
+{
+  *src1 = Reg::zero;
+  *src2 = Reg::zero;
+
+  switch (instruction.op)
+  {
+    case InstructionOp::lui:
+      *dest = instruction.i.rt;
+      return true;
+
+    case InstructionOp::andi:
+    case InstructionOp::ori:
+    case InstructionOp::xori:
+    case InstructionOp::addiu:
+    case InstructionOp::slti:
+    case InstructionOp::sltiu:
+      *dest = instruction.i.rt;
+      *src1 = instruction.i.rs;
+      return true;
+
+    case InstructionOp::funct:
+    {
+      switch (instruction.r.funct)
+      {
+        case InstructionFunct::sll:
+        case InstructionFunct::srl:
+        case InstructionFunct::sra:
+          *dest = instruction.r.rd;
+          *src1 = instruction.r.rt;
+          return true;
+
+        case InstructionFunct::sllv:
+        case InstructionFunct::srlv:
+        case InstructionFunct::srav:
+        case InstructionFunct::and_:
+        case InstructionFunct::or_:
+        case InstructionFunct::xor_:
+        case InstructionFunct::nor:
+        case InstructionFunct::addu:
+        case InstructionFunct::subu:
+        case InstructionFunct::slt:
+        case InstructionFunct::sltu:
+          *dest = instruction.r.rd;
+          *src1 = instruction.r.rs;
+          *src2 = instruction.r.rt;
+          return true;
+
+        case InstructionFunct::mfhi:
+          *dest = instruction.r.rd;
+          *src1 = Reg::hi;
+          return true;
+
+        case InstructionFunct::mflo:
+          *dest = instruction.r.rd;
+          *src1 = Reg::lo;
+          return true;
+
+        default:
+          return false;
+      }
+    }
+
+    default:
+      return false;
+  }
+}
+
+void CodeGenerator::AnalyzeBlock()
+{
+  // Constants are already propagated and folded by the register cache as the block is compiled, so the only thing
+  // which needs to look ahead is finding writes which are overwritten before anything reads them.
+  const u32 count = m_block->num_instructions;
+  m_dead_instructions.assign(count, false);
+
+  for (u32 i = 0; i < count; i++)
+  {
+    const CodeBlockInstruction& cbi = m_block_start[i];
+    Reg dest, src1, src2;
+    if (!GetPureInstructionRegisters(cbi.instruction, &dest, &src1, &src2))
+      continue;
+
+    if (dest == Reg::zero)
+    {
+      m_dead_instructions[i] = true;
+      continue;
+    }
+
+    // A write in a load delay slot races with the load, so leave it alone.
+    if (cbi.is_load_delay_slot)
+      continue;
+
+    // Anything which isn't pure could raise an exception and observe the value, or end the block.
+    for (u32 j = i + 1; j < count; j++)
+    {
+      Reg next_dest, next_src1, next_src2;
+      if (!GetPureInstructionRegisters(m_block_start[j].instruction, &next_dest, &next_src1, &next_src2) ||
+          next_src1 == dest || next_src2 == dest)
+      {
+        break;
+      }
+
+      if (next_dest == dest)
+      {
+        m_dead_instructions[i] = true;
+        break;
+      }
+    }
+  }
+}
+
 bool CodeGenerator::CompileInstruction(const CodeBlockInstruction& cbi)
 {
   bool result;
@@ -117,6 +243,8 @@ bool CodeGenerator::CompileInstruction(const CodeBlockInstruction& cbi)
       break;
 
     case InstructionOp::cop0:
+      // cop0 can change the interrupt mask or mode, which has to be picked up by the dispatcher
+      m_block_can_link = false;
       result = Compile_cop0(cbi);
       break;
 
@@ -801,6 +929,48 @@ Value CodeGenerator::NotValue(const Value& val)
   return res;
 }
 
+static MemoryAccessSize GetMemoryAccessSize(RegSize size)
+{
+  switch (size)
+  {
+    case RegSize_8:
+      return MemoryAccessSize::Byte;
+    case RegSize_16:
+      return MemoryAccessSize::HalfWord;
+    case RegSize_32:
+    default:
+      return MemoryAccessSize::Word;
+  }
+}
+
+bool CodeGenerator::EmitDirectLoadGuestMemory(const Value& address, RegSize size, Value& result)
+{
+  if (!address.IsConstant())
+    return false;
+
+  const Thunks::UncheckedReadMemoryHandler handler =
+    Thunks::GetUncheckedReadMemoryHandler(static_cast<u32>(address.constant_value), GetMemoryAccessSize(size));
+  if (!handler)
+    return false;
+
+  EmitFunctionCall(&result, handler, address);
+  return true;
+}
+
+bool CodeGenerator::EmitDirectStoreGuestMemory(const Value& address, const Value& value)
+{
+  if (!address.IsConstant())
+    return false;
+
+  const Thunks::UncheckedWriteMemoryHandler handler =
+    Thunks::GetUncheckedWriteMemoryHandler(static_cast<u32>(address.constant_value), GetMemoryAccessSize(value.size));
+  if (!handler)
+    return false;
+
+  EmitFunctionCall(nullptr, handler, address, value);
+  return true;
+}
+
 void CodeGenerator::GenerateExceptionExit(const CodeBlockInstruction& cbi, Exception excode,
                                           Condition condition /* = Condition::Always */)
 {
@@ -863,6 +1033,28 @@ void CodeGenerator::BlockEpilogue()
     m_register_cache.WriteLoadDelayToCPU(true);
 
   AddPendingCycles(true);
+
+  if (m_block->idle_loop)
+    EmitSkipIdleLoop();
+}
+
+void CodeGenerator::EmitSkipIdleLoop()
+{
+  // Nothing changes until the next event if the loop goes around again, so skip ahead to it.
+  LabelType skip_label;
+  Value pc = m_register_cache.AllocateScratch(RegSize_32);
+  EmitLoadCPUStructField(pc.host_reg, RegSize_32, offsetof(State, regs.pc));
+  EmitConditionalBranch(Condition::NotEqual, false, pc.host_reg, Value::FromConstantU32(m_block->GetPC()),
+                        &skip_label);
+  pc.ReleaseAndClear();
+
+  Value pending_ticks = m_register_cache.AllocateScratch(RegSize_32);
+  Value downcount = m_register_cache.AllocateScratch(RegSize_32);
+  EmitLoadCPUStructField(pending_ticks.host_reg, RegSize_32, offsetof(State, pending_ticks));
+  EmitLoadCPUStructField(downcount.host_reg, RegSize_32, offsetof(State, downcount));
+  EmitConditionalBranch(Condition::GreaterEqual, false, pending_ticks.host_reg, downcount, &skip_label);
+  EmitStoreCPUStructField(offsetof(State, pending_ticks), downcount);
+  EmitBindLabel(&skip_label);
 }
 
 void CodeGenerator::InstructionPrologue(const CodeBlockInstruction& cbi, TickCount cycles,
@@ -995,9 +1187,18 @@ void CodeGenerator::WriteNewPC(const Value& value, bool commit)
     m_next_pc_offset = 0;
 }
 
+bool CodeGenerator::Compile_DeadWrite(const CodeBlockInstruction& cbi)
+{
+  // Only the timing is kept.
+  InstructionPrologue(cbi, 1);
+  InstructionEpilogue(cbi);
+  return true;
+}
+
 bool CodeGenerator::Compile_Fallback(const CodeBlockInstruction& cbi)
 {
   InstructionPrologue(cbi, 1, true);
+  m_block_can_link = false;
 
   // flush and invalidate all guest registers, since the fallback could change any of them
   m_register_cache.FlushAllGuestRegisters(true, true);
@@ -1685,6 +1886,17 @@ bool CodeGenerator::Compile_Branch(const CodeBlockInstruction& cbi)
       m_register_cache.InvalidateGuestRegister(lr_reg);
   };
 
+  // When the delay slot ends the block, direct branches have statically-known successors which can be linked to.
+  auto SetBlockExits = [this, &cbi](u32 taken_pc, bool conditional) {
+    if (cbi.is_branch_delay_slot || (&cbi + 2) != m_block_end)
+      return;
+
+    m_block_exit_pcs[0] = taken_pc;
+    m_block_exit_pc_count = 1;
+    if (conditional)
+      m_block_exit_pcs[m_block_exit_pc_count++] = cbi.pc + 8;
+  };
+
   // Compute the branch target.
   // This depends on the form of the instruction.
   switch (cbi.instruction.op)
@@ -1695,6 +1907,7 @@ bool CodeGenerator::Compile_Branch(const CodeBlockInstruction& cbi)
       // npc = (pc & 0xF0000000) | (target << 2)
       Value branch_target = OrValues(AndValues(CalculatePC(), Value::FromConstantU32(0xF0000000)),
                                      Value::FromConstantU32(cbi.instruction.j.target << 2));
+      SetBlockExits(((cbi.pc + 4) & UINT32_C(0xF0000000)) | (cbi.instruction.j.target << 2), false);
 
       DoBranch(Condition::Always, Value(), Value(), (cbi.instruction.op == InstructionOp::jal) ? Reg::ra : Reg::count,
                std::move(branch_target));
@@ -1730,6 +1943,7 @@ bool CodeGenerator::Compile_Branch(const CodeBlockInstruction& cbi)
     {
       // npc = pc + (sext(imm) << 2)
       Value branch_target = CalculatePC(cbi.instruction.i.imm_sext32() << 2);
+      SetBlockExits(cbi.pc + 4 + (cbi.instruction.i.imm_sext32() << 2), true);
 
       // branch <- rs op rt
       Value lhs = m_register_cache.ReadGuestRegister(cbi.instruction.i.rs, true, true);
@@ -1744,6 +1958,7 @@ bool CodeGenerator::Compile_Branch(const CodeBlockInstruction& cbi)
     {
       // npc = pc + (sext(imm) << 2)
       Value branch_target = CalculatePC(cbi.instruction.i.imm_sext32() << 2);
+      SetBlockExits(cbi.pc + 4 + (cbi.instruction.i.imm_sext32() << 2), true);
 
       // branch <- rs op 0
       Value lhs = m_register_cache.ReadGuestRegister(cbi.instruction.i.rs, true, true);
@@ -1758,6 +1973,7 @@ bool CodeGenerator::Compile_Branch(const CodeBlockInstruction& cbi)
     {
       // npc = pc + (sext(imm) << 2)
       Value branch_target = CalculatePC(cbi.instruction.i.imm_sext32() << 2);
+      SetBlockExits(cbi.pc + 4 + (cbi.instruction.i.imm_sext32() << 2), true);
 
       const u8 rt = static_cast<u8>(cbi.instruction.i.rt.GetValue());
       const bool bgez = ConvertToBoolUnchecked(rt & u8(1));
@@ -1890,7 +2106,24 @@ bool CodeGenerator::Compile_cop0(const CodeBlockInstruction& cbi)
               value = AndValues(value, Value::FromConstantU32(write_mask));
             }
 
-            EmitStoreCPUStructField(offset, value);
+            if (reg == Cop0Reg::SR && g_settings.IsUsingFastmem())
+            {
+              // Changing cache isolation requires the fastmem views to be updated.
+              Value old_value = m_register_cache.AllocateScratch(RegSize_32);
+              EmitLoadCPUStructField(old_value.host_reg, RegSize_32, offset);
+              EmitStoreCPUStructField(offset, value);
+              EmitXor(old_value.host_reg, old_value.host_reg, value);
+
+              LabelType isc_unchanged;
+              EmitBranchIfBitClear(old_value.host_reg, RegSize_32, 16, &isc_unchanged);
+              old_value.ReleaseAndClear();
+              EmitFunctionCall(nullptr, &CPU::UpdateFastmemMapping);
+              EmitBindLabel(&isc_unchanged);
+            }
+            else
+            {
+              EmitStoreCPUStructField(offset, value);
+            }
           }
         }
 
@@ -1989,7 +2222,8 @@ Value CodeGenerator::DoGTERegisterRead(u32 index)
 
     default:
     {
-      EmitLoadCPUStructField(value.host_reg, RegSize_32, offsetof(State, gte_regs.r32[index]));
+      EmitLoadCPUStructField(value.host_reg, RegSize_32,
+                             static_cast<u32>(offsetof(State, gte_regs.r32[0]) + (index * sizeof(u32))));
     }
     break;
   }
@@ -2018,7 +2252,7 @@ void CodeGenerator::DoGTERegisterWrite(u32 index, const Value& value)
     {
       // sign-extend z component of vector registers
       Value temp = ConvertValueSize(value.ViewAsSize(RegSize_16), RegSize_32, true);
-      EmitStoreCPUStructField(offsetof(State, gte_regs.r32[index]), temp);
+      EmitStoreCPUStructField(static_cast<u32>(offsetof(State, gte_regs.r32[0]) + (index * sizeof(u32))), temp);
       return;
     }
     break;
@@ -2031,7 +2265,7 @@ void CodeGenerator::DoGTERegisterWrite(u32 index, const Value& value)
     {
       // zero-extend unsigned values
       Value temp = ConvertValueSize(value.ViewAsSize(RegSize_16), RegSize_32, false);
-      EmitStoreCPUStructField(offsetof(State, gte_regs.r32[index]), temp);
+      EmitStoreCPUStructField(static_cast<u32>(offsetof(State, gte_regs.r32[0]) + (index * sizeof(u32))), temp);
       return;
     }
     break;
@@ -2073,12 +2307,130 @@ void CodeGenerator::DoGTERegisterWrite(u32 index, const Value& value)
     default:
     {
       // written as-is, 2x16 or 1x32 bits
-      EmitStoreCPUStructField(offsetof(State, gte_regs.r32[index]), value);
+      EmitStoreCPUStructField(static_cast<u32>(offsetof(State, gte_regs.r32[0]) + (index * sizeof(u32))), value);
       return;
     }
   }
 }
 
+void CodeGenerator::DoGTENCLIP()
+{
+  // MAC0 = SX0*SY1 + SX1*SY2 + SX2*SY0 - SX0*SY2 - SX1*SY0 - SX2*SY1
+  //      = (SX1 - SX0) * (SY2 - SY0) - (SX2 - SX0) * (SY1 - SY0)
+  // The differences need 17 bits, so the products are done as 32x32->64 multiplies.
+  Value dx[2], dy[2];
+  {
+    Value sxy0 = DoGTERegisterRead(12);
+    Value sx0 = ConvertValueSize(sxy0.ViewAsSize(RegSize_16), RegSize_32, true);
+    Value sy0 = SarValues(sxy0, Value::FromConstantU32(16));
+    sxy0.ReleaseAndClear();
+
+    for (u32 i = 0; i < 2; i++)
+    {
+      Value sxy = DoGTERegisterRead(13 + i);
+      dx[i] = SubValues(ConvertValueSize(sxy.ViewAsSize(RegSize_16), RegSize_32, true), sx0, false);
+      dy[i] = SubValues(SarValues(sxy, Value::FromConstantU32(16)), sy0, false);
+    }
+  }
+
+  Value result;
+  for (u32 i = 0; i < 2; i++)
+  {
+    std::pair<Value, Value> product = MulValues(dx[i], dy[1 - i], true);
+    dx[i].ReleaseAndClear();
+    dy[1 - i].ReleaseAndClear();
+
+    // lo = (sext(hi) << 32) | zext(lo)
+    ConvertValueSizeInPlace(&product.first, RegSize_64, true);
+    ConvertValueSizeInPlace(&product.second, RegSize_64, false);
+    EmitShl(product.first.GetHostRegister(), product.first.GetHostRegister(), RegSize_64, Value::FromConstantU64(32));
+    EmitOr(product.second.GetHostRegister(), product.second.GetHostRegister(), product.first);
+
+    if (i == 0)
+      result = std::move(product.second);
+    else
+      EmitSub(result.GetHostRegister(), result.GetHostRegister(), product.second, false);
+  }
+
+  Value result_hi = SarValues(result, Value::FromConstantU64(32));
+  DoGTEMAC0Write(result_hi.ViewAsSize(RegSize_32), result.ViewAsSize(RegSize_32), false);
+}
+
+void CodeGenerator::DoGTEAVSZ(bool four)
+{
+  // result = ZSF3 * (SZ1 + SZ2 + SZ3) or ZSF4 * (SZ0 + SZ1 + SZ2 + SZ3), the SZ registers are stored zero-extended
+  // and ZSF3/ZSF4 sign-extended, so the sum can't overflow and a 32x32->64 multiply gives the exact result.
+  Value sum = AddValues(DoGTERegisterRead(17), DoGTERegisterRead(18), false);
+  sum = AddValues(sum, DoGTERegisterRead(19), false);
+  if (four)
+    sum = AddValues(sum, DoGTERegisterRead(16), false);
+
+  std::pair<Value, Value> result = MulValues(DoGTERegisterRead(four ? 62 : 61), sum, true);
+  sum.ReleaseAndClear();
+  DoGTEMAC0Write(result.first, result.second, true);
+}
+
+void CodeGenerator::DoGTEMAC0Write(const Value& result_hi, const Value& result_lo, bool set_otz)
+{
+  EmitStoreCPUStructField(offsetof(State, gte_regs.r32[24]), result_lo);
+
+  // OTZ = clamp(result >> 12, 0, 0xFFFF), the shifted result always fits in 32 bits
+  Value otz, otz_upper;
+  if (set_otz)
+  {
+    otz = OrValues(ShrValues(result_lo, Value::FromConstantU32(12)), ShlValues(result_hi, Value::FromConstantU32(20)));
+    otz_upper = ShrValues(otz, Value::FromConstantU32(16));
+  }
+
+  Value lo_sign = SarValues(result_lo, Value::FromConstantU32(31));
+  Value flags = m_register_cache.AllocateScratch(RegSize_32);
+  m_register_cache.InhibitAllocation();
+
+  // FLAG is cleared by every command
+  EmitCopyValue(flags.GetHostRegister(), Value::FromConstantU32(0));
+
+  // if the upper half isn't the sign extension of MAC0, the result didn't fit in 32 bits
+  LabelType mac0_done;
+  EmitConditionalBranch(Condition::Equal, false, result_hi.GetHostRegister(), lo_sign, &mac0_done);
+  {
+    LabelType mac0_overflow;
+    EmitConditionalBranch(Condition::PositiveOrZero, false, result_hi.GetHostRegister(), RegSize_32, &mac0_overflow);
+    EmitCopyValue(flags.GetHostRegister(), Value::FromConstantU32(UINT32_C(1) << 15));
+    EmitBranch(&mac0_done);
+    EmitBindLabel(&mac0_overflow);
+    EmitCopyValue(flags.GetHostRegister(), Value::FromConstantU32(UINT32_C(1) << 16));
+  }
+  EmitBindLabel(&mac0_done);
+
+  if (set_otz)
+  {
+    LabelType otz_done;
+    EmitConditionalBranch(Condition::Zero, false, otz_upper.GetHostRegister(), RegSize_32, &otz_done);
+    {
+      LabelType otz_positive;
+      EmitOr(flags.GetHostRegister(), flags.GetHostRegister(), Value::FromConstantU32(UINT32_C(1) << 18));
+      EmitConditionalBranch(Condition::PositiveOrZero, false, otz.GetHostRegister(), RegSize_32, &otz_positive);
+      EmitCopyValue(otz.GetHostRegister(), Value::FromConstantU32(0));
+      EmitBranch(&otz_done);
+      EmitBindLabel(&otz_positive);
+      EmitCopyValue(otz.GetHostRegister(), Value::FromConstantU32(0xFFFF));
+    }
+    EmitBindLabel(&otz_done);
+  }
+
+  // all of the flags which can be set here count as errors
+  LabelType no_error;
+  EmitConditionalBranch(Condition::Zero, false, flags.GetHostRegister(), RegSize_32, &no_error);
+  EmitOr(flags.GetHostRegister(), flags.GetHostRegister(), Value::FromConstantU32(UINT32_C(1) << 31));
+  EmitBindLabel(&no_error);
+
+  m_register_cache.UnunhibitAllocation();
+
+  if (set_otz)
+    EmitStoreCPUStructField(offsetof(State, gte_regs.r32[7]), otz);
+  EmitStoreCPUStructField(offsetof(State, gte_regs.r32[63]), flags);
+}
+
 bool CodeGenerator::Compile_cop2(const CodeBlockInstruction& cbi)
 {
   if (cbi.instruction.op == InstructionOp::lwc2 || cbi.instruction.op == InstructionOp::swc2)
@@ -2167,11 +2519,31 @@ bool CodeGenerator::Compile_cop2(const CodeBlockInstruction& cbi)
   }
   else
   {
-    // forward everything to the GTE.
     InstructionPrologue(cbi, 1);
 
-    Value instruction_bits = Value::FromConstantU32(cbi.instruction.bits & GTE::Instruction::REQUIRED_BITS_MASK);
-    EmitFunctionCall(nullptr, GTE::GetInstructionImpl(cbi.instruction.bits), instruction_bits);
+    // the depth commands are simple enough to do inline, forward everything else to the GTE.
+    const GTE::Instruction inst{cbi.instruction.bits & GTE::Instruction::REQUIRED_BITS_MASK};
+    switch (inst.command)
+    {
+      case 0x06: // NCLIP
+      {
+        // PGXP culling replaces the result with its own
+        if (g_settings.gpu_pgxp_enable && g_settings.gpu_pgxp_culling)
+          EmitFunctionCall(nullptr, GTE::GetInstructionImpl(inst.bits), Value::FromConstantU32(inst.bits));
+        else
+          DoGTENCLIP();
+      }
+      break;
+
+      case 0x2D: // AVSZ3
+      case 0x2E: // AVSZ4
+        DoGTEAVSZ(inst.command == 0x2E);
+        break;
+
+      default:
+        EmitFunctionCall(nullptr, GTE::GetInstructionImpl(inst.bits), Value::FromConstantU32(inst.bits));
+        break;
+    }
 
     InstructionEpilogue(cbi);
     return true;
@@ -2,6 +2,7 @@
 #include <array>
 #include <initializer_list>
 #include <utility>
+#include <vector>
 
 #include "common/jit_code_buffer.h"
 
@@ -23,13 +24,34 @@ public:
   static const char* GetHostRegName(HostReg reg, RegSize size = HostPointerSize);
   static void AlignCodeBuffer(JitCodeBuffer* code_buffer);
 
-  bool CompileBlock(const CodeBlock* block, CodeBlock::HostCodePointer* out_host_code, u32* out_host_code_size);
+  /// Picks the optional host instructions which can be used, from what the host supports and the settings. The code
+  /// cache must be flushed if they change.
+  static void UpdateHostFeatures();
+
+  /// Returns the HostFeature bits which generated code can use.
+  static u32 GetHostFeatures();
+
+  bool CompileBlock(CodeBlock* block, CodeBlock::HostCodePointer* out_host_code, u32* out_host_code_size);
+
+  /// Replaces a faulting fastmem access with a jump to its slowmem fallback.
+  static bool BackpatchLoadStore(const LoadStoreBackpatchInfo& lbi);
+
+  /// Changes the target of a block exit, to link or unlink it.
+  static void BackpatchBranch(void* pc, const void* target);
+
+  /// Returns false if the last compiled block references something which can't be relocated.
+  bool IsBlockCacheable() const { return m_block_cacheable; }
+  const std::vector<HostCodeRelocation>& GetRelocations() const { return m_relocations; }
+  const void* GetFarCodeStart() const { return m_far_code_start; }
+  u32 GetFarCodeSize() const { return m_far_code_size; }
 
   //////////////////////////////////////////////////////////////////////////
   // Code Generation
   //////////////////////////////////////////////////////////////////////////
   void EmitBeginBlock();
   void EmitEndBlock();
+  void EmitBlockExitLink(u32 exit_pc);
+  void EmitSkipIdleLoop();
   void EmitExceptionExit();
   void EmitExceptionExitOnBool(const Value& value);
   void FinalizeBlock(CodeBlock::HostCodePointer* out_host_code, u32* out_host_code_size);
@@ -69,7 +91,15 @@ public:
 
   // Automatically generates an exception handler.
   Value EmitLoadGuestMemory(const CodeBlockInstruction& cbi, const Value& address, RegSize size);
+  void EmitLoadGuestMemoryFastmem(const CodeBlockInstruction& cbi, const Value& address, RegSize size, Value& result);
+  void EmitLoadGuestMemorySlowmem(const Value& address, RegSize size, Value& result);
   void EmitStoreGuestMemory(const CodeBlockInstruction& cbi, const Value& address, const Value& value);
+  void EmitStoreGuestMemoryFastmem(const CodeBlockInstruction& cbi, const Value& address, const Value& value);
+  void EmitStoreGuestMemorySlowmem(const Value& address, const Value& value);
+
+  // Calls the device handler directly for constant addresses. Returns false if the generic thunk has to be used.
+  bool EmitDirectLoadGuestMemory(const Value& address, RegSize size, Value& result);
+  bool EmitDirectStoreGuestMemory(const Value& address, const Value& value);
 
   // Unconditional branch to pointer. May allocate a scratch register.
   void EmitBranch(const void* address, bool allow_scratch = true);
@@ -160,6 +190,12 @@ private:
   void* GetCurrentNearCodePointer() const;
   void* GetCurrentFarCodePointer() const;
 
+  /// Loads a pointer which is recorded as a relocation, so the code can be moved.
+  void EmitRelocatablePointer(HostReg to_reg, const void* ptr);
+
+  /// Records a reference from the field at the specified address in the current code to target.
+  void AddRelocation(HostCodeRelocation::Type type, const void* field, const void* target);
+
   //////////////////////////////////////////////////////////////////////////
   // Code Generation Helpers
   //////////////////////////////////////////////////////////////////////////
@@ -177,11 +213,18 @@ private:
 
   Value DoGTERegisterRead(u32 index);
   void DoGTERegisterWrite(u32 index, const Value& value);
+  void DoGTENCLIP();
+  void DoGTEAVSZ(bool four);
+
+  /// Stores MAC0 and FLAG, and optionally OTZ, from the 64-bit result of a depth command.
+  void DoGTEMAC0Write(const Value& result_hi, const Value& result_lo, bool set_otz);
 
   //////////////////////////////////////////////////////////////////////////
   // Instruction Code Generators
   //////////////////////////////////////////////////////////////////////////
+  void AnalyzeBlock();
   bool CompileInstruction(const CodeBlockInstruction& cbi);
+  bool Compile_DeadWrite(const CodeBlockInstruction& cbi);
   bool Compile_Fallback(const CodeBlockInstruction& cbi);
   bool Compile_Bitwise(const CodeBlockInstruction& cbi);
   bool Compile_Shift(const CodeBlockInstruction& cbi);
@@ -200,7 +243,7 @@ private:
   bool Compile_cop2(const CodeBlockInstruction& cbi);
 
   JitCodeBuffer* m_code_buffer;
-  const CodeBlock* m_block = nullptr;
+  CodeBlock* m_block = nullptr;
   const CodeBlockInstruction* m_block_start = nullptr;
   const CodeBlockInstruction* m_block_end = nullptr;
   RegisterCache m_register_cache;
@@ -213,6 +256,20 @@ private:
   TickCount m_current_instruction_pc_offset = 0;
   TickCount m_next_pc_offset = 0;
 
+  // statically-known successors of the block, which the block exits can be linked to
+  std::array<u32, 2> m_block_exit_pcs = {};
+  u32 m_block_exit_pc_count = 0;
+  bool m_block_can_link = false;
+
+  // instructions whose results are overwritten before they're read, found by AnalyzeBlock()
+  std::vector<bool> m_dead_instructions;
+
+  // everything needed to move the block's code elsewhere, for the disk cache
+  std::vector<HostCodeRelocation> m_relocations;
+  void* m_far_code_start = nullptr;
+  u32 m_far_code_size = 0;
+  bool m_block_cacheable = false;
+
   // whether various flags need to be reset.
   bool m_current_instruction_in_branch_delay_slot_dirty = false;
   bool m_branch_was_taken_dirty = false;
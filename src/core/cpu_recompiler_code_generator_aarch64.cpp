@@ -120,6 +120,13 @@ void CodeGenerator::AlignCodeBuffer(JitCodeBuffer* code_buffer)
   code_buffer->Align(16, 0x90);
 }
 
+void CodeGenerator::UpdateHostFeatures() {}
+
+u32 CodeGenerator::GetHostFeatures()
+{
+  return 0;
+}
+
 void CodeGenerator::InitHostRegs()
 {
   // TODO: function calls mess up the parameter registers if we use them.. fix it
@@ -176,6 +183,9 @@ void CodeGenerator::EmitBeginBlock()
   const bool cpu_reg_allocated = m_register_cache.AllocateHostReg(RCPUPTR);
   DebugAssert(cpu_reg_allocated);
   m_emit->Mov(GetCPUPtrReg(), reinterpret_cast<size_t>(&g_state));
+
+  // Block exits aren't linked on AArch64 yet, so always return to the dispatcher and never record link sites.
+  m_block_can_link = false;
 }
 
 void CodeGenerator::EmitEndBlock()
@@ -265,6 +275,17 @@ void CodeGenerator::EmitSignExtend(HostReg to_reg, RegSize to_size, HostReg from
       }
     }
     break;
+
+    case RegSize_64:
+    {
+      switch (from_size)
+      {
+        case RegSize_32:
+          m_emit->sxtw(GetHostReg64(to_reg), GetHostReg32(from_reg));
+          return;
+      }
+    }
+    break;
   }
 
   Panic("Unknown sign-extend combination");
@@ -298,6 +319,17 @@ void CodeGenerator::EmitZeroExtend(HostReg to_reg, RegSize to_size, HostReg from
       }
     }
     break;
+
+    case RegSize_64:
+    {
+      switch (from_size)
+      {
+        case RegSize_32:
+          m_emit->mov(GetHostReg32(to_reg), GetHostReg32(from_reg));
+          return;
+      }
+    }
+    break;
   }
 
   Panic("Unknown sign-extend combination");
@@ -1357,23 +1389,26 @@ Value CodeGenerator::EmitLoadGuestMemory(const CodeBlockInstruction& cbi, const
   else
   {
     Value result = m_register_cache.AllocateScratch(RegSize_32);
-    switch (size)
+    if (!EmitDirectLoadGuestMemory(address, size, result))
     {
-      case RegSize_8:
-        EmitFunctionCall(&result, &Thunks::UncheckedReadMemoryByte, address);
-        break;
+      switch (size)
+      {
+        case RegSize_8:
+          EmitFunctionCall(&result, &Thunks::UncheckedReadMemoryByte, address);
+          break;
 
-      case RegSize_16:
-        EmitFunctionCall(&result, &Thunks::UncheckedReadMemoryHalfWord, address);
-        break;
+        case RegSize_16:
+          EmitFunctionCall(&result, &Thunks::UncheckedReadMemoryHalfWord, address);
+          break;
 
-      case RegSize_32:
-        EmitFunctionCall(&result, &Thunks::UncheckedReadMemoryWord, address);
-        break;
+        case RegSize_32:
+          EmitFunctionCall(&result, &Thunks::UncheckedReadMemoryWord, address);
+          break;
 
-      default:
-        UnreachableCode();
-        break;
+        default:
+          UnreachableCode();
+          break;
+      }
     }
 
     // Downcast to ignore upper 56/48/32 bits. This should be a noop.
@@ -1447,7 +1482,7 @@ void CodeGenerator::EmitStoreGuestMemory(const CodeBlockInstruction& cbi, const
 
     m_register_cache.PopState();
   }
-  else
+  else if (!EmitDirectStoreGuestMemory(address, value))
   {
     switch (value.size)
     {
@@ -1470,6 +1505,19 @@ void CodeGenerator::EmitStoreGuestMemory(const CodeBlockInstruction& cbi, const
   }
 }
 
+bool CodeGenerator::BackpatchLoadStore(const LoadStoreBackpatchInfo& lbi)
+{
+  // Fastmem is not implemented for AArch64 yet.
+  Log_ErrorPrintf("Backpatching is not supported (guest PC 0x%08X)", lbi.guest_pc);
+  return false;
+}
+
+void CodeGenerator::BackpatchBranch(void* pc, const void* target)
+{
+  // Blocks can't link on AArch64 (see EmitBeginBlock()), so there are no link sites to patch.
+  Log_ErrorPrintf("Branch backpatching is not supported (host PC %p)", pc);
+}
+
 void CodeGenerator::EmitLoadGlobal(HostReg host_reg, RegSize size, const void* ptr)
 {
   Panic("Not implemented");
@@ -1,9 +1,14 @@
+#include "bus.h"
 #include "common/align.h"
+#include "common/assert.h"
+#include "common/log.h"
 #include "cpu_core.h"
 #include "cpu_core_private.h"
 #include "cpu_recompiler_code_generator.h"
 #include "cpu_recompiler_thunks.h"
 #include "settings.h"
+#include "xbyak_util.h"
+Log_SetChannel(CPU::Recompiler);
 
 namespace CPU::Recompiler {
 
@@ -14,6 +19,7 @@ constexpr HostReg RARG1 = Xbyak::Operand::RCX;
 constexpr HostReg RARG2 = Xbyak::Operand::RDX;
 constexpr HostReg RARG3 = Xbyak::Operand::R8;
 constexpr HostReg RARG4 = Xbyak::Operand::R9;
+constexpr HostReg RMEMBASEPTR = Xbyak::Operand::RBX;
 constexpr u32 FUNCTION_CALL_SHADOW_SPACE = 32;
 constexpr u64 FUNCTION_CALL_STACK_ALIGNMENT = 16;
 #elif defined(ABI_SYSV)
@@ -23,10 +29,17 @@ constexpr HostReg RARG1 = Xbyak::Operand::RDI;
 constexpr HostReg RARG2 = Xbyak::Operand::RSI;
 constexpr HostReg RARG3 = Xbyak::Operand::RDX;
 constexpr HostReg RARG4 = Xbyak::Operand::RCX;
+constexpr HostReg RMEMBASEPTR = Xbyak::Operand::RBX;
 constexpr u32 FUNCTION_CALL_SHADOW_SPACE = 0;
 constexpr u64 FUNCTION_CALL_STACK_ALIGNMENT = 16;
 #endif
 
+// Size of a jmp rel32, which fastmem accesses are padded to so they can be backpatched.
+constexpr u32 FASTMEM_BACKPATCH_JUMP_SIZE = 5;
+
+// Read by the compile thread, only changed when the code cache is flushed.
+static u32 s_host_features = 0;
+
 static const Xbyak::Reg8 GetHostReg8(HostReg reg)
 {
   return Xbyak::Reg8(reg, reg >= Xbyak::Operand::SPL);
@@ -76,6 +89,30 @@ static const Xbyak::Reg64 GetCPUPtrReg()
   return GetHostReg64(RCPUPTR);
 }
 
+static const Xbyak::Reg64 GetFastmemBasePtrReg()
+{
+  return GetHostReg64(RMEMBASEPTR);
+}
+
+static bool IsFastmemEnabled()
+{
+  return (g_state.fastmem_base != nullptr);
+}
+
+static bool CanUseFastmemForAddress(const Value& address)
+{
+  if (!IsFastmemEnabled())
+    return false;
+  if (!address.IsConstant())
+    return true;
+
+  // Only RAM is mapped, so skip straight to the slow path for constant addresses elsewhere (e.g. I/O).
+  const u32 constant_address = static_cast<u32>(address.constant_value);
+  const u32 segment = constant_address >> 29;
+  return ((segment == 0x00 || segment == 0x04 || segment == 0x05) &&
+          Bus::IsRAMAddress(constant_address & PHYSICAL_MEMORY_ADDRESS_MASK));
+}
+
 CodeGenerator::CodeGenerator(JitCodeBuffer* code_buffer)
   : m_code_buffer(code_buffer), m_register_cache(*this),
     m_near_emitter(code_buffer->GetFreeCodeSpace(), code_buffer->GetFreeCodePointer()),
@@ -120,6 +157,27 @@ void CodeGenerator::AlignCodeBuffer(JitCodeBuffer* code_buffer)
   code_buffer->Align(16, 0x90);
 }
 
+void CodeGenerator::UpdateHostFeatures()
+{
+  u32 features = 0;
+  if (g_settings.cpu_recompiler_host_extensions)
+  {
+    static const Xbyak::util::Cpu cpu;
+    if (cpu.has(Xbyak::util::Cpu::tBMI2))
+      features |= HostFeature_BMI2;
+  }
+
+  if (features != s_host_features)
+    Log_InfoPrintf("Recompiler host features: %s", (features & HostFeature_BMI2) ? "BMI2" : "none");
+
+  s_host_features = features;
+}
+
+u32 CodeGenerator::GetHostFeatures()
+{
+  return s_host_features;
+}
+
 void CodeGenerator::InitHostRegs()
 {
 #if defined(ABI_WIN64)
@@ -175,6 +233,50 @@ void* CodeGenerator::GetCurrentFarCodePointer() const
   return m_far_emitter.getCurr<void*>();
 }
 
+void CodeGenerator::EmitRelocatablePointer(HostReg to_reg, const void* ptr)
+{
+  // Always use the 64-bit immediate form, xbyak would pick a shorter one if the pointer happened to fit.
+  const Xbyak::Reg64 reg = GetHostReg64(to_reg);
+  m_emit->db(0x48 | (reg.getIdx() >= 8 ? 0x01 : 0x00));
+  m_emit->db(0xB8 | (reg.getIdx() & 7));
+  m_emit->dq(reinterpret_cast<u64>(ptr));
+  AddRelocation(HostCodeRelocation::Type::Abs64, m_emit->getCurr() - 8, ptr);
+}
+
+void CodeGenerator::AddRelocation(HostCodeRelocation::Type type, const void* field, const void* target)
+{
+  const u8* near_start = m_near_emitter.getCode();
+  const u8* far_start = m_far_emitter.getCode();
+  const u8* target_ptr = static_cast<const u8*>(target);
+
+  HostCodeRelocation reloc = {};
+  reloc.type = type;
+  reloc.in_far_code = (m_emit == &m_far_emitter);
+  reloc.offset = static_cast<u32>(static_cast<const u8*>(field) - (reloc.in_far_code ? far_start : near_start));
+  if (target == m_block)
+  {
+    reloc.target = HostCodeRelocation::Target::Block;
+  }
+  else if (target_ptr >= near_start && target_ptr < (near_start + m_code_buffer->GetFreeCodeSpace()))
+  {
+    reloc.target = HostCodeRelocation::Target::NearCode;
+    reloc.target_offset = target_ptr - near_start;
+  }
+  else if (target_ptr >= far_start && target_ptr < (far_start + m_code_buffer->GetFreeFarCodeSpace()))
+  {
+    reloc.target = HostCodeRelocation::Target::FarCode;
+    reloc.target_offset = target_ptr - far_start;
+  }
+  else
+  {
+    // Anything else had better be in the executable, since it's located relative to the CPU state when loaded.
+    reloc.target = HostCodeRelocation::Target::Image;
+    reloc.target_offset = target_ptr - reinterpret_cast<const u8*>(&g_state);
+  }
+
+  m_relocations.push_back(reloc);
+}
+
 Value CodeGenerator::GetValueInHostRegister(const Value& value, bool allow_zero_register /* = true */)
 {
   if (value.IsInHostRegister())
@@ -190,17 +292,76 @@ void CodeGenerator::EmitBeginBlock()
   // Store the CPU struct pointer.
   const bool cpu_reg_allocated = m_register_cache.AllocateHostReg(RCPUPTR);
   DebugAssert(cpu_reg_allocated);
-  m_emit->mov(GetCPUPtrReg(), reinterpret_cast<size_t>(&g_state));
+  EmitRelocatablePointer(RCPUPTR, &g_state);
+
+  // Guest memory accesses are relative to the fastmem base, so keep it in a register for the whole block.
+  if (IsFastmemEnabled())
+  {
+    const bool fastmem_reg_allocated = m_register_cache.AllocateHostReg(RMEMBASEPTR);
+    DebugAssert(fastmem_reg_allocated);
+    UNREFERENCED_VARIABLE(fastmem_reg_allocated);
+    m_emit->mov(GetFastmemBasePtrReg(), m_emit->qword[GetCPUPtrReg() + offsetof(State, fastmem_base)]);
+  }
 }
 
 void CodeGenerator::EmitEndBlock()
 {
+  // Exits to known successors jump straight to their code while there's time left in the slice.
+  Xbyak::Label return_to_dispatcher;
+  if (m_block_can_link && m_block_exit_pc_count > 0)
+  {
+    Value ticks = m_register_cache.AllocateScratch(RegSize_32);
+    m_emit->mov(GetHostReg32(ticks), m_emit->dword[GetCPUPtrReg() + offsetof(State, pending_ticks)]);
+    m_emit->cmp(GetHostReg32(ticks), m_emit->dword[GetCPUPtrReg() + offsetof(State, downcount)]);
+    m_emit->jge(return_to_dispatcher, Xbyak::CodeGenerator::T_NEAR);
+    ticks.ReleaseAndClear();
+
+    for (u32 i = 0; i < m_block_exit_pc_count; i++)
+    {
+      const u32 exit_pc = m_block_exit_pcs[i];
+      Xbyak::Label next_exit;
+      m_emit->cmp(m_emit->dword[GetCPUPtrReg() + offsetof(State, regs.pc)], exit_pc);
+      m_emit->jne(next_exit, Xbyak::CodeGenerator::T_NEAR);
+
+      // the dispatcher would normally set this, the next block's pc calculations are relative to it
+      m_emit->mov(m_emit->dword[GetCPUPtrReg() + offsetof(State, current_instruction_pc)], exit_pc);
+      m_register_cache.PopCalleeSavedRegisters(false);
+      EmitBlockExitLink(exit_pc);
+      m_emit->L(next_exit);
+    }
+  }
+
+  m_emit->L(return_to_dispatcher);
   m_register_cache.FreeHostReg(RCPUPTR);
+  if (IsFastmemEnabled())
+    m_register_cache.FreeHostReg(RMEMBASEPTR);
+
   m_register_cache.PopCalleeSavedRegisters(true);
 
   m_emit->ret();
 }
 
+void CodeGenerator::EmitBlockExitLink(u32 exit_pc)
+{
+  // Until the exit is linked, it jumps to far code which asks the dispatcher to link it.
+  BlockExitLinkInfo eli;
+  eli.host_pc = GetCurrentNearCodePointer();
+  eli.host_unlinked_pc = GetCurrentFarCodePointer();
+  eli.guest_pc = exit_pc;
+  m_emit->jmp(eli.host_unlinked_pc, Xbyak::CodeGenerator::T_NEAR);
+  AddRelocation(HostCodeRelocation::Type::Rel32, m_emit->getCurr() - 4, eli.host_unlinked_pc);
+
+  // The callee-saved registers have already been restored, so only volatile registers can be used here.
+  SwitchToFarCode();
+  EmitRelocatablePointer(Xbyak::Operand::RAX, m_block);
+  EmitRelocatablePointer(Xbyak::Operand::RCX, &CodeCache::g_link_pending_block);
+  m_emit->mov(m_emit->qword[m_emit->rcx], m_emit->rax);
+  m_emit->ret();
+  SwitchToNearCode();
+
+  m_block->exit_link_info.push_back(eli);
+}
+
 void CodeGenerator::EmitExceptionExit()
 {
   AddPendingCycles(false);
@@ -222,6 +383,7 @@ void CodeGenerator::EmitExceptionExitOnBool(const Value& value)
 
   m_emit->test(GetHostReg8(value), GetHostReg8(value));
   m_emit->jnz(GetCurrentFarCodePointer());
+  AddRelocation(HostCodeRelocation::Type::Rel32, m_emit->getCurr() - 4, GetCurrentFarCodePointer());
 
   m_register_cache.PushState();
 
@@ -241,6 +403,8 @@ void CodeGenerator::FinalizeBlock(CodeBlock::HostCodePointer* out_host_code, u32
   const u32 far_size = static_cast<u32>(m_far_emitter.getSize());
   *out_host_code = m_near_emitter.getCode<CodeBlock::HostCodePointer>();
   *out_host_code_size = near_size;
+  m_far_code_start = m_far_emitter.getCode<void*>();
+  m_far_code_size = far_size;
   m_code_buffer->CommitCode(near_size);
   m_code_buffer->CommitFarCode(far_size);
 
@@ -276,6 +440,17 @@ void CodeGenerator::EmitSignExtend(HostReg to_reg, RegSize to_size, HostReg from
       }
     }
     break;
+
+    case RegSize_64:
+    {
+      switch (from_size)
+      {
+        case RegSize_32:
+          m_emit->movsxd(GetHostReg64(to_reg), GetHostReg32(from_reg));
+          return;
+      }
+    }
+    break;
   }
 
   Panic("Unknown sign-extend combination");
@@ -309,6 +484,17 @@ void CodeGenerator::EmitZeroExtend(HostReg to_reg, RegSize to_size, HostReg from
       }
     }
     break;
+
+    case RegSize_64:
+    {
+      switch (from_size)
+      {
+        case RegSize_32:
+          m_emit->mov(GetHostReg32(to_reg), GetHostReg32(from_reg));
+          return;
+      }
+    }
+    break;
   }
 
   Panic("Unknown sign-extend combination");
@@ -509,6 +695,27 @@ void CodeGenerator::EmitCmp(HostReg to_reg, const Value& value)
 {
   DebugAssert(value.IsConstant() || value.IsInHostRegister());
 
+  // test sets the flags the same way as comparing with zero, without the immediate.
+  if (value.HasConstantValue(0))
+  {
+    switch (value.size)
+    {
+      case RegSize_8:
+        m_emit->test(GetHostReg8(to_reg), GetHostReg8(to_reg));
+        break;
+      case RegSize_16:
+        m_emit->test(GetHostReg16(to_reg), GetHostReg16(to_reg));
+        break;
+      case RegSize_32:
+        m_emit->test(GetHostReg32(to_reg), GetHostReg32(to_reg));
+        break;
+      case RegSize_64:
+        m_emit->test(GetHostReg64(to_reg), GetHostReg64(to_reg));
+        break;
+    }
+    return;
+  }
+
   switch (value.size)
   {
     case RegSize_8:
@@ -812,10 +1019,26 @@ void CodeGenerator::EmitDec(HostReg to_reg, RegSize size)
   }
 }
 
+static bool CanUseBMI2Shift(RegSize size, const Value& amount_value)
+{
+  return ((s_host_features & HostFeature_BMI2) && !amount_value.IsConstant() &&
+          (size == RegSize_32 || size == RegSize_64));
+}
+
 void CodeGenerator::EmitShl(HostReg to_reg, HostReg from_reg, RegSize size, const Value& amount_value)
 {
   DebugAssert(amount_value.IsConstant() || amount_value.IsInHostRegister());
 
+  // BMI2 can take the shift amount from any register.
+  if (CanUseBMI2Shift(size, amount_value))
+  {
+    if (size == RegSize_32)
+      m_emit->shlx(GetHostReg32(to_reg), GetHostReg32(from_reg), GetHostReg32(amount_value.host_reg));
+    else
+      m_emit->shlx(GetHostReg64(to_reg), GetHostReg64(from_reg), GetHostReg64(amount_value.host_reg));
+    return;
+  }
+
   // We have to use CL for the shift amount :(
   const bool save_cl = (!amount_value.IsConstant() && m_register_cache.IsHostRegInUse(Xbyak::Operand::RCX) &&
                         (!amount_value.IsInHostRegister() || amount_value.host_reg != Xbyak::Operand::RCX));
@@ -884,6 +1107,16 @@ void CodeGenerator::EmitShr(HostReg to_reg, HostReg from_reg, RegSize size, cons
 {
   DebugAssert(amount_value.IsConstant() || amount_value.IsInHostRegister());
 
+  // BMI2 can take the shift amount from any register.
+  if (CanUseBMI2Shift(size, amount_value))
+  {
+    if (size == RegSize_32)
+      m_emit->shrx(GetHostReg32(to_reg), GetHostReg32(from_reg), GetHostReg32(amount_value.host_reg));
+    else
+      m_emit->shrx(GetHostReg64(to_reg), GetHostReg64(from_reg), GetHostReg64(amount_value.host_reg));
+    return;
+  }
+
   // We have to use CL for the shift amount :(
   const bool save_cl = (!amount_value.IsConstant() && m_register_cache.IsHostRegInUse(Xbyak::Operand::RCX) &&
                         (!amount_value.IsInHostRegister() || amount_value.host_reg != Xbyak::Operand::RCX));
@@ -952,6 +1185,16 @@ void CodeGenerator::EmitSar(HostReg to_reg, HostReg from_reg, RegSize size, cons
 {
   DebugAssert(amount_value.IsConstant() || amount_value.IsInHostRegister());
 
+  // BMI2 can take the shift amount from any register.
+  if (CanUseBMI2Shift(size, amount_value))
+  {
+    if (size == RegSize_32)
+      m_emit->sarx(GetHostReg32(to_reg), GetHostReg32(from_reg), GetHostReg32(amount_value.host_reg));
+    else
+      m_emit->sarx(GetHostReg64(to_reg), GetHostReg64(from_reg), GetHostReg64(amount_value.host_reg));
+    return;
+  }
+
   // We have to use CL for the shift amount :(
   const bool save_cl = (!amount_value.IsConstant() && m_register_cache.IsHostRegInUse(Xbyak::Operand::RCX) &&
                         (!amount_value.IsInHostRegister() || amount_value.host_reg != Xbyak::Operand::RCX));
@@ -1404,10 +1647,11 @@ void CodeGenerator::EmitFunctionCallPtr(Value* return_value, const void* ptr)
   if (Xbyak::inner::IsInInt32(reinterpret_cast<size_t>(ptr) - reinterpret_cast<size_t>(m_emit->getCurr())))
   {
     m_emit->call(ptr);
+    AddRelocation(HostCodeRelocation::Type::Rel32, m_emit->getCurr() - 4, ptr);
   }
   else
   {
-    m_emit->mov(GetHostReg64(RRETURN), reinterpret_cast<size_t>(ptr));
+    EmitRelocatablePointer(RRETURN, ptr);
     m_emit->call(GetHostReg64(RRETURN));
   }
 
@@ -1437,10 +1681,11 @@ void CodeGenerator::EmitFunctionCallPtr(Value* return_value, const void* ptr, co
   if (Xbyak::inner::IsInInt32(reinterpret_cast<size_t>(ptr) - reinterpret_cast<size_t>(m_emit->getCurr())))
   {
     m_emit->call(ptr);
+    AddRelocation(HostCodeRelocation::Type::Rel32, m_emit->getCurr() - 4, ptr);
   }
   else
   {
-    m_emit->mov(GetHostReg64(RRETURN), reinterpret_cast<size_t>(ptr));
+    EmitRelocatablePointer(RRETURN, ptr);
     m_emit->call(GetHostReg64(RRETURN));
   }
 
@@ -1471,10 +1716,11 @@ void CodeGenerator::EmitFunctionCallPtr(Value* return_value, const void* ptr, co
   if (Xbyak::inner::IsInInt32(reinterpret_cast<size_t>(ptr) - reinterpret_cast<size_t>(m_emit->getCurr())))
   {
     m_emit->call(ptr);
+    AddRelocation(HostCodeRelocation::Type::Rel32, m_emit->getCurr() - 4, ptr);
   }
   else
   {
-    m_emit->mov(GetHostReg64(RRETURN), reinterpret_cast<size_t>(ptr));
+    EmitRelocatablePointer(RRETURN, ptr);
     m_emit->call(GetHostReg64(RRETURN));
   }
 
@@ -1507,10 +1753,11 @@ void CodeGenerator::EmitFunctionCallPtr(Value* return_value, const void* ptr, co
   if (Xbyak::inner::IsInInt32(reinterpret_cast<size_t>(ptr) - reinterpret_cast<size_t>(m_emit->getCurr())))
   {
     m_emit->call(ptr);
+    AddRelocation(HostCodeRelocation::Type::Rel32, m_emit->getCurr() - 4, ptr);
   }
   else
   {
-    m_emit->mov(GetHostReg64(RRETURN), reinterpret_cast<size_t>(ptr));
+    EmitRelocatablePointer(RRETURN, ptr);
     m_emit->call(GetHostReg64(RRETURN));
   }
 
@@ -1544,10 +1791,11 @@ void CodeGenerator::EmitFunctionCallPtr(Value* return_value, const void* ptr, co
   if (Xbyak::inner::IsInInt32(reinterpret_cast<size_t>(ptr) - reinterpret_cast<size_t>(m_emit->getCurr())))
   {
     m_emit->call(ptr);
+    AddRelocation(HostCodeRelocation::Type::Rel32, m_emit->getCurr() - 4, ptr);
   }
   else
   {
-    m_emit->mov(GetHostReg64(RRETURN), reinterpret_cast<size_t>(ptr));
+    EmitRelocatablePointer(RRETURN, ptr);
     m_emit->call(GetHostReg64(RRETURN));
   }
 
@@ -1767,6 +2015,7 @@ Value CodeGenerator::EmitLoadGuestMemory(const CodeBlockInstruction& cbi, const
 
     m_emit->test(GetHostReg64(result.host_reg), GetHostReg64(result.host_reg));
     m_emit->js(GetCurrentFarCodePointer());
+    AddRelocation(HostCodeRelocation::Type::Rel32, m_emit->getCurr() - 4, GetCurrentFarCodePointer());
 
     m_register_cache.PushState();
 
@@ -1811,24 +2060,10 @@ Value CodeGenerator::EmitLoadGuestMemory(const CodeBlockInstruction& cbi, const
   else
   {
     Value result = m_register_cache.AllocateScratch(RegSize_32);
-    switch (size)
-    {
-      case RegSize_8:
-        EmitFunctionCall(&result, &Thunks::UncheckedReadMemoryByte, address);
-        break;
-
-      case RegSize_16:
-        EmitFunctionCall(&result, &Thunks::UncheckedReadMemoryHalfWord, address);
-        break;
-
-      case RegSize_32:
-        EmitFunctionCall(&result, &Thunks::UncheckedReadMemoryWord, address);
-        break;
-
-      default:
-        UnreachableCode();
-        break;
-    }
+    if (CanUseFastmemForAddress(address))
+      EmitLoadGuestMemoryFastmem(cbi, address, size, result);
+    else
+      EmitLoadGuestMemorySlowmem(address, size, result);
 
     // Downcast to ignore upper 56/48/32 bits. This should be a noop.
     switch (size)
@@ -1853,6 +2088,97 @@ Value CodeGenerator::EmitLoadGuestMemory(const CodeBlockInstruction& cbi, const
   }
 }
 
+void CodeGenerator::EmitLoadGuestMemoryFastmem(const CodeBlockInstruction& cbi, const Value& address, RegSize size,
+                                               Value& result)
+{
+  // Constant addresses above 2GB can't be encoded as a displacement.
+  Value address_reg;
+  if (address.IsConstant() && address.constant_value >= UINT32_C(0x80000000))
+    address_reg = GetValueInHostRegister(address);
+  const Value& fastmem_address = address_reg.IsValid() ? address_reg : address;
+  const Xbyak::RegExp address_exp =
+    fastmem_address.IsConstant() ? (GetFastmemBasePtrReg() + static_cast<u32>(fastmem_address.constant_value)) :
+                                   (GetFastmemBasePtrReg() + GetHostReg64(fastmem_address.host_reg));
+
+  LoadStoreBackpatchInfo bpi;
+  bpi.host_pc = GetCurrentNearCodePointer();
+  bpi.guest_pc = cbi.pc;
+
+  switch (size)
+  {
+    case RegSize_8:
+      m_emit->movzx(GetHostReg32(result.host_reg), m_emit->byte[address_exp]);
+      break;
+
+    case RegSize_16:
+      m_emit->movzx(GetHostReg32(result.host_reg), m_emit->word[address_exp]);
+      break;
+
+    case RegSize_32:
+      m_emit->mov(GetHostReg32(result.host_reg), m_emit->dword[address_exp]);
+      break;
+
+    default:
+      UnreachableCode();
+      break;
+  }
+
+  // Pad the access so it can be overwritten with a jump.
+  while ((static_cast<u8*>(GetCurrentNearCodePointer()) - static_cast<u8*>(bpi.host_pc)) <
+         FASTMEM_BACKPATCH_JUMP_SIZE)
+  {
+    m_emit->nop();
+  }
+
+  bpi.host_code_size =
+    static_cast<u32>(static_cast<u8*>(GetCurrentNearCodePointer()) - static_cast<u8*>(bpi.host_pc));
+
+  // Fastmem accesses always hit RAM.
+  m_delayed_cycles_add += Bus::RAM_READ_TICKS;
+
+  // Generate the slowmem fallback, which is jumped to after backpatching.
+  bpi.host_slowmem_pc = GetCurrentFarCodePointer();
+  SwitchToFarCode();
+  m_register_cache.PushState();
+
+  EmitLoadGuestMemorySlowmem(address, size, result);
+
+  // The slowmem thunk has already added the access ticks, so undo the RAM ticks added by the fast path.
+  EmitAddCPUStructField(offsetof(State, pending_ticks), Value::FromConstantU32(static_cast<u32>(-Bus::RAM_READ_TICKS)));
+
+  EmitBranch(static_cast<u8*>(bpi.host_pc) + bpi.host_code_size, false);
+
+  m_register_cache.PopState();
+  SwitchToNearCode();
+
+  m_block->loadstore_backpatch_info.push_back(bpi);
+}
+
+void CodeGenerator::EmitLoadGuestMemorySlowmem(const Value& address, RegSize size, Value& result)
+{
+  if (EmitDirectLoadGuestMemory(address, size, result))
+    return;
+
+  switch (size)
+  {
+    case RegSize_8:
+      EmitFunctionCall(&result, &Thunks::UncheckedReadMemoryByte, address);
+      break;
+
+    case RegSize_16:
+      EmitFunctionCall(&result, &Thunks::UncheckedReadMemoryHalfWord, address);
+      break;
+
+    case RegSize_32:
+      EmitFunctionCall(&result, &Thunks::UncheckedReadMemoryWord, address);
+      break;
+
+    default:
+      UnreachableCode();
+      break;
+  }
+}
+
 void CodeGenerator::EmitStoreGuestMemory(const CodeBlockInstruction& cbi, const Value& address, const Value& value)
 {
   AddPendingCycles(true);
@@ -1883,6 +2209,7 @@ void CodeGenerator::EmitStoreGuestMemory(const CodeBlockInstruction& cbi, const
 
     m_emit->test(GetHostReg32(result), GetHostReg32(result));
     m_emit->jnz(GetCurrentFarCodePointer());
+    AddRelocation(HostCodeRelocation::Type::Rel32, m_emit->getCurr() - 4, GetCurrentFarCodePointer());
 
     // store exception path
     SwitchToFarCode();
@@ -1901,29 +2228,144 @@ void CodeGenerator::EmitStoreGuestMemory(const CodeBlockInstruction& cbi, const
   }
   else
   {
-    switch (value.size)
-    {
-      case RegSize_8:
-        EmitFunctionCall(nullptr, &Thunks::UncheckedWriteMemoryByte, address, value);
-        break;
+    if (CanUseFastmemForAddress(address))
+      EmitStoreGuestMemoryFastmem(cbi, address, value);
+    else
+      EmitStoreGuestMemorySlowmem(address, value);
+  }
+}
 
-      case RegSize_16:
-        EmitFunctionCall(nullptr, &Thunks::UncheckedWriteMemoryHalfWord, address, value);
-        break;
+void CodeGenerator::EmitStoreGuestMemoryFastmem(const CodeBlockInstruction& cbi, const Value& address,
+                                                const Value& value)
+{
+  // Constant addresses above 2GB can't be encoded as a displacement.
+  Value address_reg;
+  if (address.IsConstant() && address.constant_value >= UINT32_C(0x80000000))
+    address_reg = GetValueInHostRegister(address);
+  const Value& fastmem_address = address_reg.IsValid() ? address_reg : address;
+  const Xbyak::RegExp address_exp =
+    fastmem_address.IsConstant() ? (GetFastmemBasePtrReg() + static_cast<u32>(fastmem_address.constant_value)) :
+                                   (GetFastmemBasePtrReg() + GetHostReg64(fastmem_address.host_reg));
 
-      case RegSize_32:
-        EmitFunctionCall(nullptr, &Thunks::UncheckedWriteMemoryWord, address, value);
-        break;
+  LoadStoreBackpatchInfo bpi;
+  bpi.host_pc = GetCurrentNearCodePointer();
+  bpi.guest_pc = cbi.pc;
 
-      default:
-        UnreachableCode();
-        break;
+  switch (value.size)
+  {
+    case RegSize_8:
+    {
+      if (value.IsConstant())
+        m_emit->mov(m_emit->byte[address_exp], Truncate8(value.constant_value));
+      else
+        m_emit->mov(m_emit->byte[address_exp], GetHostReg8(value.host_reg));
+    }
+    break;
+
+    case RegSize_16:
+    {
+      if (value.IsConstant())
+        m_emit->mov(m_emit->word[address_exp], Truncate16(value.constant_value));
+      else
+        m_emit->mov(m_emit->word[address_exp], GetHostReg16(value.host_reg));
+    }
+    break;
+
+    case RegSize_32:
+    {
+      if (value.IsConstant())
+        m_emit->mov(m_emit->dword[address_exp], Truncate32(value.constant_value));
+      else
+        m_emit->mov(m_emit->dword[address_exp], GetHostReg32(value.host_reg));
     }
+    break;
+
+    default:
+      UnreachableCode();
+      break;
+  }
+
+  // Pad the access so it can be overwritten with a jump.
+  while ((static_cast<u8*>(GetCurrentNearCodePointer()) - static_cast<u8*>(bpi.host_pc)) <
+         FASTMEM_BACKPATCH_JUMP_SIZE)
+  {
+    m_emit->nop();
+  }
+
+  bpi.host_code_size =
+    static_cast<u32>(static_cast<u8*>(GetCurrentNearCodePointer()) - static_cast<u8*>(bpi.host_pc));
+
+  // Generate the slowmem fallback, which is jumped to after backpatching.
+  bpi.host_slowmem_pc = GetCurrentFarCodePointer();
+  SwitchToFarCode();
+  m_register_cache.PushState();
+
+  EmitStoreGuestMemorySlowmem(address, value);
+  EmitBranch(static_cast<u8*>(bpi.host_pc) + bpi.host_code_size, false);
+
+  m_register_cache.PopState();
+  SwitchToNearCode();
+
+  m_block->loadstore_backpatch_info.push_back(bpi);
+}
+
+void CodeGenerator::EmitStoreGuestMemorySlowmem(const Value& address, const Value& value)
+{
+  if (EmitDirectStoreGuestMemory(address, value))
+    return;
+
+  switch (value.size)
+  {
+    case RegSize_8:
+      EmitFunctionCall(nullptr, &Thunks::UncheckedWriteMemoryByte, address, value);
+      break;
+
+    case RegSize_16:
+      EmitFunctionCall(nullptr, &Thunks::UncheckedWriteMemoryHalfWord, address, value);
+      break;
+
+    case RegSize_32:
+      EmitFunctionCall(nullptr, &Thunks::UncheckedWriteMemoryWord, address, value);
+      break;
+
+    default:
+      UnreachableCode();
+      break;
   }
 }
 
+bool CodeGenerator::BackpatchLoadStore(const LoadStoreBackpatchInfo& lbi)
+{
+  Log_DevPrintf("Backpatching %p (guest PC 0x%08X) to slowmem at %p", lbi.host_pc, lbi.guest_pc,
+                lbi.host_slowmem_pc);
+
+  // turn it into a jump to the slowmem handler
+  Xbyak::CodeGenerator cg(lbi.host_code_size, lbi.host_pc);
+  cg.jmp(lbi.host_slowmem_pc, Xbyak::CodeGenerator::T_NEAR);
+
+  const s32 nops = static_cast<s32>(lbi.host_code_size) - static_cast<s32>(cg.getSize());
+  Assert(nops >= 0);
+  for (s32 i = 0; i < nops; i++)
+    cg.nop();
+
+  JitCodeBuffer::FlushInstructionCache(lbi.host_pc, lbi.host_code_size);
+  return true;
+}
+
+void CodeGenerator::BackpatchBranch(void* pc, const void* target)
+{
+  Log_DebugPrintf("Backpatching branch at %p to %p", pc, target);
+
+  Xbyak::CodeGenerator cg(FASTMEM_BACKPATCH_JUMP_SIZE, pc);
+  cg.jmp(target, Xbyak::CodeGenerator::T_NEAR);
+  JitCodeBuffer::FlushInstructionCache(pc, static_cast<u32>(cg.getSize()));
+}
+
 void CodeGenerator::EmitLoadGlobal(HostReg host_reg, RegSize size, const void* ptr)
 {
+  // rip-relative accesses aren't recorded as relocations
+  m_block_cacheable = false;
+
   const s64 displacement =
     static_cast<s64>(reinterpret_cast<size_t>(ptr) - reinterpret_cast<size_t>(m_emit->getCurr())) + 2;
   if (Xbyak::inner::IsInInt32(static_cast<u64>(displacement)))
@@ -1988,6 +2430,9 @@ void CodeGenerator::EmitStoreGlobal(void* ptr, const Value& value)
 {
   DebugAssert(value.IsInHostRegister() || value.IsConstant());
 
+  // rip-relative accesses aren't recorded as relocations
+  m_block_cacheable = false;
+
   const s64 displacement =
     static_cast<s64>(reinterpret_cast<size_t>(ptr) - reinterpret_cast<size_t>(m_emit->getCurr()));
   if (Xbyak::inner::IsInInt32(static_cast<u64>(displacement)))
@@ -2186,14 +2631,15 @@ void CodeGenerator::EmitBranch(const void* address, bool allow_scratch)
     static_cast<s64>(reinterpret_cast<intptr_t>(address) - reinterpret_cast<intptr_t>(GetCurrentCodePointer()));
   if (Xbyak::inner::IsInInt32(static_cast<u64>(jump_distance)))
   {
-    m_emit->jmp(address);
+    m_emit->jmp(address, Xbyak::CodeGenerator::T_NEAR);
+    AddRelocation(HostCodeRelocation::Type::Rel32, m_emit->getCurr() - 4, address);
     return;
   }
 
   Assert(allow_scratch);
 
   Value temp = m_register_cache.AllocateScratch(RegSize_64);
-  m_emit->mov(GetHostReg64(temp), reinterpret_cast<uintptr_t>(address));
+  EmitRelocatablePointer(temp.host_reg, address);
   m_emit->jmp(GetHostReg64(temp));
 }
 
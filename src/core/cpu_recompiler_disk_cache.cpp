@@ -0,0 +1,462 @@
+#include "cpu_recompiler_disk_cache.h"
+#include "common/assert.h"
+#include "common/file_system.h"
+#include "common/jit_code_buffer.h"
+#include "common/log.h"
+#include "common/string_util.h"
+#include "cpu_core.h"
+#include "cpu_core_private.h"
+#include "cpu_recompiler_code_generator.h"
+#include "host_interface.h"
+#include "settings.h"
+#include <cstdio>
+#include <cstring>
+#include <limits>
+#include <unordered_map>
+#include <vector>
+#if defined(WIN32)
+#include "common/windows_headers.h"
+#else
+#include <dlfcn.h>
+#endif
+Log_SetChannel(CPU::Recompiler::DiskCache);
+
+namespace CPU::Recompiler::DiskCache {
+
+static constexpr u32 FILE_MAGIC = 0x54494A44; // DJIT
+static constexpr u32 FILE_VERSION = 4;
+
+// Blocks aren't added once the cache holds this much code, so it can't grow without bound across games.
+static constexpr u32 MAX_CACHED_CODE_SIZE = 32 * 1024 * 1024;
+
+struct FileHeader
+{
+  u32 magic;
+  u32 version;
+  u32 build_hash;
+  u32 entry_count;
+};
+
+struct EntryHeader
+{
+  u32 key;
+  u32 config;
+  u32 num_instructions;
+  u32 near_code_size;
+  u32 far_code_size;
+  u32 num_relocations;
+  u32 num_backpatches;
+  u32 num_exit_links;
+};
+
+struct BackpatchRecord
+{
+  u32 host_offset;     // offset of the fastmem access in near code
+  u32 slowmem_offset;  // offset of the slowmem fallback in far code
+  u32 host_code_size;
+  u32 guest_pc;
+};
+
+struct ExitLinkRecord
+{
+  u32 host_offset;     // offset of the patchable jump in near code
+  u32 unlinked_offset; // offset of the dispatcher return in far code
+  u32 guest_pc;
+};
+
+struct Entry
+{
+  EntryHeader header;
+  std::vector<u32> instructions;
+  std::vector<u8> near_code;
+  std::vector<u8> far_code;
+  std::vector<HostCodeRelocation> relocations;
+  std::vector<BackpatchRecord> backpatches;
+  std::vector<ExitLinkRecord> exit_links;
+};
+
+using EntryMap = std::unordered_map<u64, Entry>;
+
+static std::string s_filename;
+static EntryMap s_entries;
+static u32 s_cached_code_size = 0;
+static u32 s_blocks_loaded = 0;
+static u32 s_blocks_stored = 0;
+static bool s_open = false;
+static bool s_dirty = false;
+static u32 s_build_hash = 0;
+
+static u32 HashBytes(u32 hash, const void* data, size_t size)
+{
+  // FNV-1a
+  const u8* bytes = static_cast<const u8*>(data);
+  for (size_t i = 0; i < size; i++)
+    hash = (hash ^ bytes[i]) * 16777619u;
+
+  return hash;
+}
+
+static constexpr u32 HASH_SEED = 2166136261u;
+
+/// Everything the generated code can depend on, other than the guest instructions.
+static u32 GetCodegenConfig()
+{
+  return BoolToUInt32(g_state.fastmem_base != nullptr) | (BoolToUInt32(g_settings.IsUsingFastmem()) << 1) |
+         (BoolToUInt32(g_settings.cpu_recompiler_memory_exceptions) << 2) |
+         (BoolToUInt32(g_settings.gpu_pgxp_enable) << 3) | (BoolToUInt32(g_settings.gpu_pgxp_culling) << 4) |
+         (BoolToUInt32(g_settings.cpu_idle_loop_skipping) << 5) | (CodeGenerator::GetHostFeatures() << 6);
+}
+
+/// Cached code calls into this binary through offsets from the CPU state, so it is only usable by the exact module
+/// that wrote it. The module's path, size and modification time change whenever it's relinked, so they identify the
+/// build, including local builds which share a commit.
+static bool GetBuildHash(u32* hash)
+{
+  std::string path;
+#if defined(WIN32)
+  HMODULE module;
+  wchar_t module_path[MAX_PATH];
+  if (!GetModuleHandleExW(GET_MODULE_HANDLE_EX_FLAG_FROM_ADDRESS | GET_MODULE_HANDLE_EX_FLAG_UNCHANGED_REFCOUNT,
+                          reinterpret_cast<LPCWSTR>(&GetBuildHash), &module))
+  {
+    return false;
+  }
+
+  const DWORD length = GetModuleFileNameW(module, module_path, MAX_PATH);
+  if (length == 0 || length == MAX_PATH)
+    return false;
+
+  path = StringUtil::WideStringToUTF8String(std::wstring_view(module_path, length));
+#else
+  Dl_info info;
+  if (dladdr(reinterpret_cast<const void*>(&GetBuildHash), &info) == 0 || !info.dli_fname)
+    return false;
+
+  path = info.dli_fname;
+#endif
+
+  FILESYSTEM_STAT_DATA sd;
+  if (!FileSystem::StatFile(path.c_str(), &sd))
+    return false;
+
+  const u64 modification_time = sd.ModificationTime.AsUnixTimestamp();
+  u32 value = HashBytes(HASH_SEED, &FILE_VERSION, sizeof(FILE_VERSION));
+  value = HashBytes(value, path.data(), path.size());
+  value = HashBytes(value, &sd.Size, sizeof(sd.Size));
+  value = HashBytes(value, &modification_time, sizeof(modification_time));
+  *hash = value;
+  return true;
+}
+
+/// Blocks compiled with different settings are kept separately, so switching back and forth doesn't evict them.
+static u64 GetEntryKey(u32 key, u32 config, const u32* instructions, u32 num_instructions)
+{
+  const u32 hash = HashBytes(HashBytes(HASH_SEED, &config, sizeof(config)), instructions, sizeof(u32) * num_instructions);
+  return (static_cast<u64>(key) << 32) | static_cast<u64>(hash);
+}
+
+template<typename T>
+static bool ReadArray(std::FILE* fp, std::vector<T>& arr, u32 count)
+{
+  arr.resize(count);
+  return (count == 0 || std::fread(arr.data(), sizeof(T) * count, 1, fp) == 1);
+}
+
+template<typename T>
+static bool WriteArray(std::FILE* fp, const std::vector<T>& arr)
+{
+  return (arr.empty() || std::fwrite(arr.data(), sizeof(T) * arr.size(), 1, fp) == 1);
+}
+
+static bool ReadFile(std::FILE* fp)
+{
+  FileHeader header;
+  if (std::fread(&header, sizeof(header), 1, fp) != 1 || header.magic != FILE_MAGIC ||
+      header.version != FILE_VERSION)
+  {
+    Log_WarningPrintf("Recompiler cache '%s' is invalid, ignoring.", s_filename.c_str());
+    return false;
+  }
+
+  if (header.build_hash != s_build_hash)
+  {
+    Log_InfoPrintf("Recompiler cache '%s' was created by a different build, ignoring.", s_filename.c_str());
+    return false;
+  }
+
+  for (u32 i = 0; i < header.entry_count; i++)
+  {
+    Entry entry;
+    if (std::fread(&entry.header, sizeof(entry.header), 1, fp) != 1 ||
+        !ReadArray(fp, entry.instructions, entry.header.num_instructions) ||
+        !ReadArray(fp, entry.near_code, entry.header.near_code_size) ||
+        !ReadArray(fp, entry.far_code, entry.header.far_code_size) ||
+        !ReadArray(fp, entry.relocations, entry.header.num_relocations) ||
+        !ReadArray(fp, entry.backpatches, entry.header.num_backpatches) ||
+        !ReadArray(fp, entry.exit_links, entry.header.num_exit_links))
+    {
+      Log_WarningPrintf("Failed to read entry %u from recompiler cache '%s', ignoring.", i, s_filename.c_str());
+      return false;
+    }
+
+    s_cached_code_size += entry.header.near_code_size + entry.header.far_code_size;
+    const u64 key = GetEntryKey(entry.header.key, entry.header.config, entry.instructions.data(),
+                                  entry.header.num_instructions);
+    s_entries.emplace(key, std::move(entry));
+  }
+
+  return true;
+}
+
+static bool WriteFile(std::FILE* fp)
+{
+  FileHeader header = {};
+  header.magic = FILE_MAGIC;
+  header.version = FILE_VERSION;
+  header.build_hash = s_build_hash;
+  header.entry_count = static_cast<u32>(s_entries.size());
+  if (std::fwrite(&header, sizeof(header), 1, fp) != 1)
+    return false;
+
+  for (const auto& it : s_entries)
+  {
+    const Entry& entry = it.second;
+    if (std::fwrite(&entry.header, sizeof(entry.header), 1, fp) != 1 || !WriteArray(fp, entry.instructions) ||
+        !WriteArray(fp, entry.near_code) || !WriteArray(fp, entry.far_code) || !WriteArray(fp, entry.relocations) ||
+        !WriteArray(fp, entry.backpatches) || !WriteArray(fp, entry.exit_links))
+    {
+      return false;
+    }
+  }
+
+  return true;
+}
+
+void Open(const BIOS::Hash& bios_hash)
+{
+  Close();
+
+#if defined(CPU_X64)
+  if (!GetBuildHash(&s_build_hash))
+  {
+    Log_WarningPrint("Could not identify the running binary, recompiler disk cache is disabled.");
+    return;
+  }
+
+  s_filename =
+    g_host_interface->GetUserDirectoryRelativePath("cache/recompiler_%s.bin", bios_hash.ToString().c_str());
+  s_open = true;
+
+  std::FILE* fp = FileSystem::OpenCFile(s_filename.c_str(), "rb");
+  if (!fp)
+    return;
+
+  if (!ReadFile(fp))
+  {
+    s_entries.clear();
+    s_cached_code_size = 0;
+  }
+
+  std::fclose(fp);
+  Log_InfoPrintf("Loaded %zu blocks from recompiler cache '%s'", s_entries.size(), s_filename.c_str());
+#else
+  Log_WarningPrint("Recompiler disk cache is not supported on this host.");
+#endif
+}
+
+void Close()
+{
+  if (!s_open)
+    return;
+
+  Log_InfoPrintf("Recompiler cache: %u blocks loaded, %u blocks added", s_blocks_loaded, s_blocks_stored);
+
+  if (s_dirty)
+  {
+    FileSystem::CreateDirectory(g_host_interface->GetUserDirectoryRelativePath("cache").c_str(), false);
+
+    std::FILE* fp = FileSystem::OpenCFile(s_filename.c_str(), "wb");
+    const bool result = fp && WriteFile(fp);
+    if (fp)
+      std::fclose(fp);
+
+    if (!result)
+    {
+      Log_ErrorPrintf("Failed to write recompiler cache '%s'", s_filename.c_str());
+      FileSystem::DeleteFile(s_filename.c_str());
+    }
+  }
+
+  s_filename = {};
+  s_entries.clear();
+  s_cached_code_size = 0;
+  s_blocks_loaded = 0;
+  s_blocks_stored = 0;
+  s_open = false;
+  s_dirty = false;
+}
+
+bool IsOpen()
+{
+  return s_open;
+}
+
+bool LoadBlock(CodeBlock* block, JitCodeBuffer* code_buffer, CodeBlock::HostCodePointer* out_host_code,
+               u32* out_host_code_size)
+{
+  if (!s_open)
+    return false;
+
+  // The block's instructions aren't contiguous, so gather the words to hash them.
+  std::vector<u32> instructions(block->num_instructions);
+  for (u32 i = 0; i < block->num_instructions; i++)
+    instructions[i] = block->instructions[i].instruction.bits;
+
+  const u32 config = GetCodegenConfig();
+  const EntryMap::const_iterator iter =
+    s_entries.find(GetEntryKey(block->key.bits, config, instructions.data(), block->num_instructions));
+  if (iter == s_entries.end())
+    return false;
+
+  const Entry& entry = iter->second;
+  if (entry.header.key != block->key.bits || entry.header.config != config ||
+      entry.instructions != instructions || entry.header.near_code_size > code_buffer->GetFreeCodeSpace() ||
+      entry.header.far_code_size > code_buffer->GetFreeFarCodeSpace())
+  {
+    return false;
+  }
+
+  u8* near_code = code_buffer->GetFreeCodePointer();
+  u8* far_code = code_buffer->GetFreeFarCodePointer();
+  std::memcpy(near_code, entry.near_code.data(), entry.header.near_code_size);
+  std::memcpy(far_code, entry.far_code.data(), entry.header.far_code_size);
+
+  for (const HostCodeRelocation& reloc : entry.relocations)
+  {
+    u8* field = (reloc.in_far_code ? far_code : near_code) + reloc.offset;
+    const u8* target;
+    switch (reloc.target)
+    {
+      case HostCodeRelocation::Target::Image:
+        target = reinterpret_cast<const u8*>(&g_state) + reloc.target_offset;
+        break;
+      case HostCodeRelocation::Target::NearCode:
+        target = near_code + reloc.target_offset;
+        break;
+      case HostCodeRelocation::Target::FarCode:
+        target = far_code + reloc.target_offset;
+        break;
+      case HostCodeRelocation::Target::Block:
+      default:
+        target = reinterpret_cast<const u8*>(block);
+        break;
+    }
+
+    if (reloc.type == HostCodeRelocation::Type::Rel32)
+    {
+      const s64 displacement = target - (field + sizeof(s32));
+      if (displacement < std::numeric_limits<s32>::min() || displacement > std::numeric_limits<s32>::max())
+      {
+        Log_WarningPrintf("Relocation out of range in cached block 0x%08X", block->GetPC());
+        return false;
+      }
+
+      const s32 displacement32 = static_cast<s32>(displacement);
+      std::memcpy(field, &displacement32, sizeof(displacement32));
+    }
+    else
+    {
+      const u64 address = reinterpret_cast<u64>(target);
+      std::memcpy(field, &address, sizeof(address));
+    }
+  }
+
+  *out_host_code = reinterpret_cast<CodeBlock::HostCodePointer>(near_code);
+  *out_host_code_size = entry.header.near_code_size;
+  for (const BackpatchRecord& bpr : entry.backpatches)
+  {
+    LoadStoreBackpatchInfo lbi;
+    lbi.host_pc = near_code + bpr.host_offset;
+    lbi.host_slowmem_pc = far_code + bpr.slowmem_offset;
+    lbi.host_code_size = bpr.host_code_size;
+    lbi.guest_pc = bpr.guest_pc;
+    block->loadstore_backpatch_info.push_back(lbi);
+  }
+  for (const ExitLinkRecord& elr : entry.exit_links)
+  {
+    BlockExitLinkInfo eli;
+    eli.host_pc = near_code + elr.host_offset;
+    eli.host_unlinked_pc = far_code + elr.unlinked_offset;
+    eli.guest_pc = elr.guest_pc;
+    block->exit_link_info.push_back(eli);
+  }
+
+  code_buffer->CommitCode(entry.header.near_code_size);
+  code_buffer->CommitFarCode(entry.header.far_code_size);
+  JitCodeBuffer::FlushInstructionCache(near_code, entry.header.near_code_size);
+  JitCodeBuffer::FlushInstructionCache(far_code, entry.header.far_code_size);
+
+  Log_DebugPrintf("Loaded block 0x%08X from recompiler cache", block->GetPC());
+  s_blocks_loaded++;
+  return true;
+}
+
+void StoreBlock(const CodeBlock* block, CodeBlock::HostCodePointer host_code, u32 host_code_size,
+                const CodeGenerator& codegen)
+{
+  if (!s_open || !codegen.IsBlockCacheable() ||
+      (s_cached_code_size + host_code_size + codegen.GetFarCodeSize()) > MAX_CACHED_CODE_SIZE)
+  {
+    return;
+  }
+
+  const u8* near_code = reinterpret_cast<const u8*>(host_code);
+  const u8* far_code = static_cast<const u8*>(codegen.GetFarCodeStart());
+
+  Entry entry;
+  entry.header.key = block->key.bits;
+  entry.header.config = GetCodegenConfig();
+  entry.header.num_instructions = block->num_instructions;
+  entry.header.near_code_size = host_code_size;
+  entry.header.far_code_size = codegen.GetFarCodeSize();
+  entry.header.num_relocations = static_cast<u32>(codegen.GetRelocations().size());
+  entry.header.num_backpatches = static_cast<u32>(block->loadstore_backpatch_info.size());
+  entry.header.num_exit_links = static_cast<u32>(block->exit_link_info.size());
+
+  entry.instructions.resize(block->num_instructions);
+  for (u32 i = 0; i < block->num_instructions; i++)
+    entry.instructions[i] = block->instructions[i].instruction.bits;
+
+  entry.near_code.assign(near_code, near_code + host_code_size);
+  entry.far_code.assign(far_code, far_code + codegen.GetFarCodeSize());
+  entry.relocations = codegen.GetRelocations();
+
+  for (const LoadStoreBackpatchInfo& lbi : block->loadstore_backpatch_info)
+  {
+    entry.backpatches.push_back(BackpatchRecord{static_cast<u32>(static_cast<const u8*>(lbi.host_pc) - near_code),
+                                                static_cast<u32>(static_cast<const u8*>(lbi.host_slowmem_pc) - far_code),
+                                                lbi.host_code_size, lbi.guest_pc});
+  }
+  for (const BlockExitLinkInfo& eli : block->exit_link_info)
+  {
+    entry.exit_links.push_back(ExitLinkRecord{static_cast<u32>(static_cast<const u8*>(eli.host_pc) - near_code),
+                                              static_cast<u32>(static_cast<const u8*>(eli.host_unlinked_pc) - far_code),
+                                              eli.guest_pc});
+  }
+
+  const u64 key = GetEntryKey(entry.header.key, entry.header.config, entry.instructions.data(),
+                                  entry.header.num_instructions);
+  auto iter = s_entries.find(key);
+  if (iter != s_entries.end())
+  {
+    s_cached_code_size -= iter->second.header.near_code_size + iter->second.header.far_code_size;
+    s_entries.erase(iter);
+  }
+
+  s_cached_code_size += entry.header.near_code_size + entry.header.far_code_size;
+  s_entries.emplace(key, std::move(entry));
+  s_blocks_stored++;
+  s_dirty = true;
+}
+
+} // namespace CPU::Recompiler::DiskCache
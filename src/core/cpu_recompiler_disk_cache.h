@@ -0,0 +1,34 @@
+#pragma once
+#include "bios.h"
+#include "cpu_code_cache.h"
+
+class JitCodeBuffer;
+
+namespace CPU::Recompiler {
+
+class CodeGenerator;
+
+namespace DiskCache {
+
+// None of these are thread safe. The compile thread only uses the cache while the emulation thread isn't compiling.
+
+/// Loads previously compiled blocks for the specified BIOS. Only supported on x64 hosts.
+void Open(const BIOS::Hash& bios_hash);
+
+/// Writes any newly compiled blocks back to disk, and releases the cache.
+void Close();
+
+bool IsOpen();
+
+/// Copies the host code for the block into the code buffer and relocates it, if a block with identical guest code
+/// was compiled with the same settings. Returns false if the block has to be compiled instead.
+bool LoadBlock(CodeBlock* block, JitCodeBuffer* code_buffer, CodeBlock::HostCodePointer* out_host_code,
+               u32* out_host_code_size);
+
+/// Adds a block which was just compiled by codegen. Must be called before the code is linked or backpatched.
+void StoreBlock(const CodeBlock* block, CodeBlock::HostCodePointer host_code, u32 host_code_size,
+                const CodeGenerator& codegen);
+
+} // namespace DiskCache
+
+} // namespace CPU::Recompiler
@@ -0,0 +1,188 @@
+#include "cpu_recompiler_thread.h"
+#include "common/assert.h"
+#include "common/jit_code_buffer.h"
+#include "common/log.h"
+#include "common/timer.h"
+#include "cpu_recompiler_code_generator.h"
+#include "cpu_recompiler_disk_cache.h"
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <thread>
+Log_SetChannel(CPU::Recompiler::CompileThread);
+
+namespace CPU::Recompiler::CompileThread {
+
+// The worker has its own code buffer, so the emulation thread never sees partially-written code.
+static constexpr u32 THREAD_CODE_CACHE_SIZE = 16 * 1024 * 1024;
+static constexpr u32 THREAD_FAR_CODE_CACHE_SIZE = 16 * 1024 * 1024;
+static constexpr u32 THREAD_GUARD_SIZE = 4096;
+alignas(CODE_STORAGE_ALIGNMENT) static u8 s_code_storage[THREAD_CODE_CACHE_SIZE + THREAD_FAR_CODE_CACHE_SIZE];
+static JitCodeBuffer s_code_buffer;
+
+static void WorkerThreadEntryPoint();
+static void CompileBlock(CodeBlock* block, CompiledBlock* cb);
+
+static std::thread s_thread;
+static std::mutex s_mutex;
+static std::condition_variable s_work_cv;
+static std::condition_variable s_block_done_cv;
+static std::deque<CodeBlock*> s_queued_blocks;
+static std::deque<CompiledBlock> s_compiled_blocks;
+static CodeBlock* s_current_block = nullptr;
+static std::atomic_bool s_has_compiled_blocks{false};
+static std::atomic_bool s_shutdown_flag{true};
+
+void Start()
+{
+  if (IsRunning())
+    return;
+
+  if (!s_code_buffer.Initialize(s_code_storage, sizeof(s_code_storage), THREAD_FAR_CODE_CACHE_SIZE, THREAD_GUARD_SIZE))
+    Panic("Failed to initialize compile thread code space");
+
+  s_shutdown_flag.store(false);
+  s_thread = std::thread(WorkerThreadEntryPoint);
+}
+
+void Stop()
+{
+  if (!IsRunning())
+    return;
+
+  Reset();
+
+  {
+    std::unique_lock<std::mutex> lock(s_mutex);
+    s_shutdown_flag.store(true);
+    s_work_cv.notify_one();
+  }
+
+  s_thread.join();
+  s_code_buffer.Destroy();
+}
+
+bool IsRunning()
+{
+  return s_thread.joinable();
+}
+
+void QueueBlock(CodeBlock* block)
+{
+  Start();
+
+  std::unique_lock<std::mutex> lock(s_mutex);
+  s_queued_blocks.push_back(block);
+  s_work_cv.notify_one();
+}
+
+bool HasCompiledBlocks()
+{
+  return s_has_compiled_blocks.load(std::memory_order_acquire);
+}
+
+bool GetCompiledBlock(CompiledBlock* cb)
+{
+  std::unique_lock<std::mutex> lock(s_mutex);
+  if (s_compiled_blocks.empty())
+    return false;
+
+  *cb = s_compiled_blocks.front();
+  s_compiled_blocks.pop_front();
+  s_has_compiled_blocks.store(!s_compiled_blocks.empty(), std::memory_order_release);
+  return true;
+}
+
+void CancelBlock(CodeBlock* block)
+{
+  std::unique_lock<std::mutex> lock(s_mutex);
+  if (s_current_block == block)
+    s_block_done_cv.wait(lock, [block]() { return s_current_block != block; });
+
+  s_queued_blocks.erase(std::remove(s_queued_blocks.begin(), s_queued_blocks.end(), block), s_queued_blocks.end());
+  s_compiled_blocks.erase(std::remove_if(s_compiled_blocks.begin(), s_compiled_blocks.end(),
+                                         [block](const CompiledBlock& cb) { return cb.block == block; }),
+                          s_compiled_blocks.end());
+  s_has_compiled_blocks.store(!s_compiled_blocks.empty(), std::memory_order_release);
+}
+
+void Reset()
+{
+  if (!IsRunning())
+    return;
+
+  std::unique_lock<std::mutex> lock(s_mutex);
+  s_queued_blocks.clear();
+  if (s_current_block)
+    s_block_done_cv.wait(lock, []() { return s_current_block == nullptr; });
+
+  s_compiled_blocks.clear();
+  s_has_compiled_blocks.store(false, std::memory_order_release);
+  s_code_buffer.Reset();
+}
+
+void CompileBlock(CodeBlock* block, CompiledBlock* cb)
+{
+  cb->block = block;
+  cb->host_code = nullptr;
+  cb->host_code_size = 0;
+  cb->out_of_space = false;
+
+  // The cache can't be flushed from this thread, so the emulation thread has to do it.
+  const u32 num_instructions = block->num_instructions;
+  if (s_code_buffer.GetFreeCodeSpace() < (num_instructions * MAX_NEAR_HOST_BYTES_PER_INSTRUCTION) ||
+      s_code_buffer.GetFreeFarCodeSpace() < (num_instructions * MAX_FAR_HOST_BYTES_PER_INSTRUCTION))
+  {
+    cb->out_of_space = true;
+    return;
+  }
+
+  // The emulation thread leaves these alone until the block has host code. The host code pointer is only set when the
+  // block is published, since the emulation thread uses it to tell whether the block is compiled.
+  block->loadstore_backpatch_info.clear();
+  block->exit_link_info.clear();
+
+  if (DiskCache::LoadBlock(block, &s_code_buffer, &cb->host_code, &cb->host_code_size))
+    return;
+
+  Common::Timer timer;
+  CodeGenerator codegen(&s_code_buffer);
+  if (!codegen.CompileBlock(block, &cb->host_code, &cb->host_code_size))
+  {
+    Log_ErrorPrintf("Failed to compile host code for block at 0x%08X", block->GetPC());
+    return;
+  }
+
+  DiskCache::StoreBlock(block, cb->host_code, cb->host_code_size, codegen);
+  Log_DevPrintf("Compiled block at 0x%08X in %.3f msec", block->GetPC(), timer.GetTimeMilliseconds());
+}
+
+void WorkerThreadEntryPoint()
+{
+  std::unique_lock<std::mutex> lock(s_mutex);
+
+  while (!s_shutdown_flag.load())
+  {
+    s_work_cv.wait(lock, []() { return (s_shutdown_flag.load() || !s_queued_blocks.empty()); });
+    if (s_queued_blocks.empty())
+      continue;
+
+    CodeBlock* block = s_queued_blocks.front();
+    s_queued_blocks.pop_front();
+    s_current_block = block;
+
+    CompiledBlock cb;
+    lock.unlock();
+    CompileBlock(block, &cb);
+    lock.lock();
+
+    s_compiled_blocks.push_back(cb);
+    s_has_compiled_blocks.store(true, std::memory_order_release);
+    s_current_block = nullptr;
+    s_block_done_cv.notify_all();
+  }
+}
+
+} // namespace CPU::Recompiler::CompileThread
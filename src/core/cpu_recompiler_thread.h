@@ -0,0 +1,44 @@
+#pragma once
+#include "cpu_code_cache.h"
+
+namespace CPU::Recompiler::CompileThread {
+
+/// Host code for a block which was compiled on the worker thread, waiting to be attached to the block.
+struct CompiledBlock
+{
+  CodeBlock* block;
+
+  // null if compilation failed, the backpatch and exit link info is written directly to the block
+  CodeBlock::HostCodePointer host_code;
+  u32 host_code_size;
+
+  // the worker's code buffer is full, the cache has to be flushed before anything else can be compiled
+  bool out_of_space;
+};
+
+/// Starts the worker thread, and sets up its code buffer.
+void Start();
+
+/// Discards any queued blocks, and stops the worker thread.
+void Stop();
+
+bool IsRunning();
+
+/// Queues the block for compilation on the worker thread. The block's instructions must stay valid until the
+/// result has been retrieved, or the thread is reset.
+void QueueBlock(CodeBlock* block);
+
+/// Removes the block from the queue, waiting for it if it's being compiled. Its result is discarded, so the block's
+/// instructions can be changed afterwards.
+void CancelBlock(CodeBlock* block);
+
+/// Returns true if there are compiled blocks waiting to be retrieved.
+bool HasCompiledBlocks();
+
+/// Retrieves the next compiled block. Must be called on the emulation thread.
+bool GetCompiledBlock(CompiledBlock* cb);
+
+/// Waits for the block in progress, discards all queued and compiled blocks, and resets the worker's code buffer.
+void Reset();
+
+} // namespace CPU::Recompiler::CompileThread
@@ -30,6 +30,12 @@ void UncheckedWriteMemoryByte(u32 address, u8 value);
 void UncheckedWriteMemoryHalfWord(u32 address, u16 value);
 void UncheckedWriteMemoryWord(u32 address, u32 value);
 
+// Handlers which call straight into the device for a constant address, skipping the address decoding. Returns nullptr
+// if the address needs to go through the unchecked functions above.
+using UncheckedReadMemoryHandler = u32 (*)(u32 address);
+using UncheckedWriteMemoryHandler = void (*)(u32 address, u32 value);
+UncheckedReadMemoryHandler GetUncheckedReadMemoryHandler(u32 address, MemoryAccessSize size);
+UncheckedWriteMemoryHandler GetUncheckedWriteMemoryHandler(u32 address, MemoryAccessSize size);
 
 } // namespace Recompiler::Thunks
 
@@ -55,6 +55,37 @@ enum class Condition : u8
   Zero
 };
 
+/// Optional host instructions which generated code can use, see CodeGenerator::UpdateHostFeatures().
+enum HostFeature : u32
+{
+  HostFeature_BMI2 = (1 << 0), // shlx/shrx/sarx
+};
+
+/// A reference from generated code to something outside of the block, which must be fixed up if the code is moved.
+struct HostCodeRelocation
+{
+  enum class Type : u8
+  {
+    Rel32, // 32-bit displacement, relative to the end of the field
+    Abs64, // 64-bit absolute address
+  };
+
+  enum class Target : u8
+  {
+    Image,    // code or data in the executable, relative to the CPU state
+    NearCode, // relative to the start of the block's near code
+    FarCode,  // relative to the start of the block's far code
+    Block,    // the CodeBlock itself
+  };
+
+  s64 target_offset;
+  u32 offset; // offset of the field in the block's near or far code
+  Type type;
+  Target target;
+  bool in_far_code;
+  u8 padding;
+};
+
 #if defined(CPU_X64)
 
 using HostReg = Xbyak::Operand::Code;
@@ -25,7 +25,10 @@ void DMA::Initialize()
 
   m_transfer_buffer.resize(32);
   m_unhalt_event = TimingEvents::CreateTimingEvent("DMA Transfer Unhalt", 1, m_max_slice_ticks,
-                                                   std::bind(&DMA::UnhaltTransfer, this, std::placeholders::_1), false);
+                                                   [](void* param, TickCount ticks, TickCount ticks_late) {
+                                                     static_cast<DMA*>(param)->UnhaltTransfer(ticks);
+                                                   },
+                                                   this, false);
 
   Reset();
 }
@@ -429,8 +432,9 @@ void DMA::UnhaltTransfer(TickCount ticks)
 TickCount DMA::TransferMemoryToDevice(Channel channel, u32 address, u32 increment, u32 word_count)
 {
   const u32* src_pointer = reinterpret_cast<u32*>(Bus::g_ram + address);
-  if (channel != Channel::GPU &&
-      (static_cast<s32>(increment) < 0 || ((address + (increment * word_count)) & ADDRESS_MASK) <= address))
+  const bool contiguous =
+    (static_cast<s32>(increment) > 0 && ((address + (increment * word_count)) & ADDRESS_MASK) > address);
+  if (channel != Channel::GPU && !contiguous)
   {
     // Use temp buffer if it's wrapping around
     if (m_transfer_buffer.size() < word_count)
@@ -451,13 +455,21 @@ TickCount DMA::TransferMemoryToDevice(Channel channel, u32 address, u32 incremen
     {
       if (g_gpu->BeginDMAWrite())
       {
-        u8* ram_pointer = Bus::g_ram;
-        for (u32 i = 0; i < word_count; i++)
+        if (contiguous)
         {
-          u32 value;
-          std::memcpy(&value, &ram_pointer[address], sizeof(u32));
-          g_gpu->DMAWrite(address, value);
-          address = (address + increment) & ADDRESS_MASK;
+          g_gpu->DMAWriteBlock(address, src_pointer, word_count);
+        }
+        else
+        {
+          // the GPU needs the source address of each word for PGXP, so it can't use the temp buffer
+          u8* ram_pointer = Bus::g_ram;
+          for (u32 i = 0; i < word_count; i++)
+          {
+            u32 value;
+            std::memcpy(&value, &ram_pointer[address], sizeof(u32));
+            g_gpu->DMAWrite(address, value);
+            address = (address + increment) & ADDRESS_MASK;
+          }
         }
         g_gpu->EndDMAWrite();
       }
@@ -28,9 +28,13 @@ bool GPU::Initialize(HostDisplay* host_display)
   m_force_ntsc_timings = g_settings.gpu_force_ntsc_timings;
   m_crtc_state.display_aspect_ratio = Settings::GetDisplayAspectRatioValue(g_settings.display_aspect_ratio);
   m_crtc_tick_event = TimingEvents::CreateTimingEvent(
-    "GPU CRTC Tick", 1, 1, std::bind(&GPU::CRTCTickEvent, this, std::placeholders::_1), true);
+    "GPU CRTC Tick", 1, 1,
+    [](void* param, TickCount ticks, TickCount ticks_late) { static_cast<GPU*>(param)->CRTCTickEvent(ticks); }, this,
+    true);
   m_command_tick_event = TimingEvents::CreateTimingEvent(
-    "GPU Command Tick", 1, 1, std::bind(&GPU::CommandTickEvent, this, std::placeholders::_1), true);
+    "GPU Command Tick", 1, 1,
+    [](void* param, TickCount ticks, TickCount ticks_late) { static_cast<GPU*>(param)->CommandTickEvent(ticks); }, this,
+    true);
   m_fifo_size = g_settings.gpu_fifo_size;
   m_max_run_ahead = g_settings.gpu_max_run_ahead;
   m_console_is_pal = System::IsPALRegion();
@@ -351,6 +355,29 @@ void GPU::DMARead(u32* words, u32 word_count)
     words[i] = ReadGPUREAD();
 }
 
+void GPU::DMAWriteBlock(u32 address, const u32* words, u32 word_count)
+{
+  // Fill the FIFO a contiguous run at a time, instead of updating the queue for every word.
+  while (word_count > 0)
+  {
+    const u32 count = std::min(word_count, m_fifo.GetContiguousSpace());
+    if (count == 0)
+    {
+      Log_WarningPrintf("GPU FIFO overflow, dropping %u DMA words", word_count);
+      return;
+    }
+
+    u64* dst = m_fifo.GetWritePointer();
+    for (u32 i = 0; i < count; i++)
+      dst[i] = (ZeroExtend64(address + (i * sizeof(u32))) << 32) | ZeroExtend64(words[i]);
+
+    m_fifo.AdvanceTail(count);
+    address += count * sizeof(u32);
+    words += count;
+    word_count -= count;
+  }
+}
+
 void GPU::EndDMAWrite()
 {
   m_fifo_pushed = true;
@@ -142,6 +142,8 @@ public:
   {
     m_fifo.Push((ZeroExtend64(address) << 32) | ZeroExtend64(value));
   }
+  /// Pushes a span of words which are contiguous in RAM starting at address, without wrapping.
+  void DMAWriteBlock(u32 address, const u32* words, u32 word_count);
   void EndDMAWrite();
 
   /// Returns the number of pending GPU ticks.
@@ -3,6 +3,8 @@
 #include "common/bitutils.h"
 #include "common/state_wrapper.h"
 #include "cpu_core.h"
+#include "gte_divider.h"
+#include "gte_transform.h"
 #include "pgxp.h"
 #include "settings.h"
 #include <algorithm>
@@ -21,6 +23,8 @@ static constexpr s32 IR123_MAX_VALUE = (INT64_C(1) << 15) - 1;
 
 #define REGS CPU::g_state.gte_regs
 
+static TransformVerticesFunction s_transform_vertices = TransformVerticesScalar;
+
 ALWAYS_INLINE static u32 CountLeadingBits(u32 value)
 {
   // if top-most bit is set, we want to count ones not zeros
@@ -148,6 +152,7 @@ static u32 TruncateRGB(s32 value)
 
 void Initialize()
 {
+  s_transform_vertices = GetTransformVerticesFunction();
   Reset();
 }
 
@@ -366,50 +371,6 @@ static void PushRGBFromMAC()
   REGS.dr32[22] = r | (g << 8) | (b << 16) | (c << 24); // RGB2 <- Value
 }
 
-static u32 UNRDivide(u32 lhs, u32 rhs)
-{
-  if (rhs * 2 <= lhs)
-  {
-    REGS.FLAG.divide_overflow = true;
-    return 0x1FFFF;
-  }
-
-  const u32 shift = (rhs == 0) ? 16 : CountLeadingZeros(static_cast<u16>(rhs));
-  lhs <<= shift;
-  rhs <<= shift;
-
-  static constexpr std::array<u8, 257> unr_table = {{
-    0xFF, 0xFD, 0xFB, 0xF9, 0xF7, 0xF5, 0xF3, 0xF1, 0xEF, 0xEE, 0xEC, 0xEA, 0xE8, 0xE6, 0xE4, 0xE3, //
-    0xE1, 0xDF, 0xDD, 0xDC, 0xDA, 0xD8, 0xD6, 0xD5, 0xD3, 0xD1, 0xD0, 0xCE, 0xCD, 0xCB, 0xC9, 0xC8, //  00h..3Fh
-    0xC6, 0xC5, 0xC3, 0xC1, 0xC0, 0xBE, 0xBD, 0xBB, 0xBA, 0xB8, 0xB7, 0xB5, 0xB4, 0xB2, 0xB1, 0xB0, //
-    0xAE, 0xAD, 0xAB, 0xAA, 0xA9, 0xA7, 0xA6, 0xA4, 0xA3, 0xA2, 0xA0, 0x9F, 0x9E, 0x9C, 0x9B, 0x9A, //
-    0x99, 0x97, 0x96, 0x95, 0x94, 0x92, 0x91, 0x90, 0x8F, 0x8D, 0x8C, 0x8B, 0x8A, 0x89, 0x87, 0x86, //
-    0x85, 0x84, 0x83, 0x82, 0x81, 0x7F, 0x7E, 0x7D, 0x7C, 0x7B, 0x7A, 0x79, 0x78, 0x77, 0x75, 0x74, //  40h..7Fh
-    0x73, 0x72, 0x71, 0x70, 0x6F, 0x6E, 0x6D, 0x6C, 0x6B, 0x6A, 0x69, 0x68, 0x67, 0x66, 0x65, 0x64, //
-    0x63, 0x62, 0x61, 0x60, 0x5F, 0x5E, 0x5D, 0x5D, 0x5C, 0x5B, 0x5A, 0x59, 0x58, 0x57, 0x56, 0x55, //
-    0x54, 0x53, 0x53, 0x52, 0x51, 0x50, 0x4F, 0x4E, 0x4D, 0x4D, 0x4C, 0x4B, 0x4A, 0x49, 0x48, 0x48, //
-    0x47, 0x46, 0x45, 0x44, 0x43, 0x43, 0x42, 0x41, 0x40, 0x3F, 0x3F, 0x3E, 0x3D, 0x3C, 0x3C, 0x3B, //  80h..BFh
-    0x3A, 0x39, 0x39, 0x38, 0x37, 0x36, 0x36, 0x35, 0x34, 0x33, 0x33, 0x32, 0x31, 0x31, 0x30, 0x2F, //
-    0x2E, 0x2E, 0x2D, 0x2C, 0x2C, 0x2B, 0x2A, 0x2A, 0x29, 0x28, 0x28, 0x27, 0x26, 0x26, 0x25, 0x24, //
-    0x24, 0x23, 0x22, 0x22, 0x21, 0x20, 0x20, 0x1F, 0x1E, 0x1E, 0x1D, 0x1D, 0x1C, 0x1B, 0x1B, 0x1A, //
-    0x19, 0x19, 0x18, 0x18, 0x17, 0x16, 0x16, 0x15, 0x15, 0x14, 0x14, 0x13, 0x12, 0x12, 0x11, 0x11, //  C0h..FFh
-    0x10, 0x0F, 0x0F, 0x0E, 0x0E, 0x0D, 0x0D, 0x0C, 0x0C, 0x0B, 0x0A, 0x0A, 0x09, 0x09, 0x08, 0x08, //
-    0x07, 0x07, 0x06, 0x06, 0x05, 0x05, 0x04, 0x04, 0x03, 0x03, 0x02, 0x02, 0x01, 0x01, 0x00, 0x00, //
-    0x00 // <-- one extra table entry (for "(d-7FC0h)/80h"=100h)
-  }};
-
-  const u32 divisor = rhs | 0x8000;
-  const s32 x = static_cast<s32>(0x101 + ZeroExtend32(unr_table[((divisor & 0x7FFF) + 0x40) >> 7]));
-  const s32 d = ((static_cast<s32>(ZeroExtend32(divisor)) * -x) + 0x80) >> 8;
-  const u32 recip = static_cast<u32>(((x * (0x20000 + d)) + 0x80) >> 8);
-
-  const u32 result = Truncate32((ZeroExtend64(lhs) * ZeroExtend64(recip) + u64(0x8000)) >> 16);
-
-  // The min(1FFFFh) limit is needed for cases like FE3Fh/7F20h, F015h/780Bh, etc. (these do produce UNR result 20000h,
-  // and are saturated to 1FFFFh, but without setting overflow FLAG bits).
-  return std::min<u32>(0x1FFFF, result);
-}
-
 static void MulMatVec(const s16 M[3][3], const s16 Vx, const s16 Vy, const s16 Vz, u8 shift, bool lm)
 {
 #define dot3(i)                                                                                                        \
@@ -465,31 +426,33 @@ static void Execute_MVMVA(Instruction inst)
 {
   REGS.FLAG.Clear();
 
-  // TODO: Remove memcpy..
-  s16 M[3][3];
+  // The real matrices are used in place, only the buggy one has to be built.
+  s16 buggy_M[3][3];
+  const s16(*M)[3];
   switch (inst.mvmva_multiply_matrix)
   {
     case 0:
-      std::memcpy(M, REGS.RT, sizeof(s16) * 3 * 3);
+      M = REGS.RT;
       break;
     case 1:
-      std::memcpy(M, REGS.LLM, sizeof(s16) * 3 * 3);
+      M = REGS.LLM;
       break;
     case 2:
-      std::memcpy(M, REGS.LCM, sizeof(s16) * 3 * 3);
+      M = REGS.LCM;
       break;
     default:
     {
       // buggy
-      M[0][0] = -static_cast<s16>(ZeroExtend16(REGS.RGBC[0]) << 4);
-      M[0][1] = static_cast<s16>(ZeroExtend16(REGS.RGBC[0]) << 4);
-      M[0][2] = REGS.IR0;
-      M[1][0] = REGS.RT[0][2];
-      M[1][1] = REGS.RT[0][2];
-      M[1][2] = REGS.RT[0][2];
-      M[2][0] = REGS.RT[1][1];
-      M[2][1] = REGS.RT[1][1];
-      M[2][2] = REGS.RT[1][1];
+      buggy_M[0][0] = -static_cast<s16>(ZeroExtend16(REGS.RGBC[0]) << 4);
+      buggy_M[0][1] = static_cast<s16>(ZeroExtend16(REGS.RGBC[0]) << 4);
+      buggy_M[0][2] = REGS.IR0;
+      buggy_M[1][0] = REGS.RT[0][2];
+      buggy_M[1][1] = REGS.RT[0][2];
+      buggy_M[1][2] = REGS.RT[0][2];
+      buggy_M[2][0] = REGS.RT[1][1];
+      buggy_M[2][1] = REGS.RT[1][1];
+      buggy_M[2][2] = REGS.RT[1][1];
+      M = buggy_M;
     }
     break;
   }
@@ -580,22 +543,18 @@ static void Execute_OP(Instruction inst)
   REGS.FLAG.UpdateError();
 }
 
-static void RTPS(const s16 V[3], u8 shift, bool lm, bool last)
+static void RTPS(const s64 MAC[3], u8 shift, bool lm, bool last)
 {
-#define dot3(i)                                                                                                        \
-  SignExtendMACResult<i + 1>(SignExtendMACResult<i + 1>((s64(REGS.TR[i]) << 12) + (s64(REGS.RT[i][0]) * s64(V[0]))) +  \
-                             (s64(REGS.RT[i][1]) * s64(V[1]))) +                                                       \
-    (s64(REGS.RT[i][2]) * s64(V[2]))
-
   // IR1 = MAC1 = (TRX*1000h + RT11*VX0 + RT12*VY0 + RT13*VZ0) SAR (sf*12)
   // IR2 = MAC2 = (TRY*1000h + RT21*VX0 + RT22*VY0 + RT23*VZ0) SAR (sf*12)
   // IR3 = MAC3 = (TRZ*1000h + RT31*VX0 + RT32*VY0 + RT33*VZ0) SAR (sf*12)
-  const s64 x = dot3(0);
-  const s64 y = dot3(1);
-  const s64 z = dot3(2);
-  TruncateAndSetMAC<1>(x, shift);
-  TruncateAndSetMAC<2>(y, shift);
-  TruncateAndSetMAC<3>(z, shift);
+  // The MAC overflow flags were already set by the transform.
+  const s64 x = MAC[0];
+  const s64 y = MAC[1];
+  const s64 z = MAC[2];
+  REGS.dr32[25] = Truncate32(static_cast<u64>(x >> shift));
+  REGS.dr32[26] = Truncate32(static_cast<u64>(y >> shift));
+  REGS.dr32[27] = Truncate32(static_cast<u64>(z >> shift));
   TruncateAndSetIR<1>(REGS.MAC1, lm);
   TruncateAndSetIR<2>(REGS.MAC2, lm);
 
@@ -604,14 +563,15 @@ static void RTPS(const s16 V[3], u8 shift, bool lm, bool last)
   // when "MAC3" exceeds -8000h..+7FFFh).
   TruncateAndSetIR<3>(s32(z >> 12), false);
   REGS.dr32[11] = std::clamp(REGS.MAC3, lm ? 0 : IR123_MIN_VALUE, IR123_MAX_VALUE);
-#undef dot3
 
   // SZ3 = MAC3 SAR ((1-sf)*12)                           ;ScreenZ FIFO 0..+FFFFh
   PushSZ(s32(z >> 12));
 
   // MAC0=(((H*20000h/SZ3)+1)/2)*IR1+OFX, SX2=MAC0/10000h ;ScrX FIFO -400h..+3FFh
   // MAC0=(((H*20000h/SZ3)+1)/2)*IR2+OFY, SY2=MAC0/10000h ;ScrY FIFO -400h..+3FFh
-  const s64 result = static_cast<s64>(ZeroExtend64(UNRDivide(REGS.H, REGS.SZ3)));
+  bool divide_overflow;
+  const s64 result = static_cast<s64>(ZeroExtend64(UNRDivide(REGS.H, REGS.SZ3, &divide_overflow)));
+  REGS.FLAG.divide_overflow |= divide_overflow;
 
   // (4 / 3) / (16 / 9) -> 0.75 -> (3 / 4)
   const s64 Sx = g_settings.gpu_widescreen_hack ?
@@ -649,7 +609,12 @@ static void RTPS(const s16 V[3], u8 shift, bool lm, bool last)
 static void Execute_RTPS(Instruction inst)
 {
   REGS.FLAG.Clear();
-  RTPS(REGS.V0, inst.GetShift(), inst.lm, true);
+
+  const s16* const vertices[1] = {REGS.V0};
+  s64 MAC[1][3];
+  REGS.FLAG.bits |= s_transform_vertices(REGS.RT, REGS.TR, vertices, 1, MAC);
+  RTPS(MAC[0], inst.GetShift(), inst.lm, true);
+
   REGS.FLAG.UpdateError();
 }
 
@@ -660,9 +625,13 @@ static void Execute_RTPT(Instruction inst)
   const u8 shift = inst.GetShift();
   const bool lm = inst.lm;
 
-  RTPS(REGS.V0, shift, lm, false);
-  RTPS(REGS.V1, shift, lm, false);
-  RTPS(REGS.V2, shift, lm, true);
+  // All three vertices are transformed at once, the rest only depends on the previous vertex through the FIFOs.
+  const s16* const vertices[3] = {REGS.V0, REGS.V1, REGS.V2};
+  s64 MAC[3][3];
+  REGS.FLAG.bits |= s_transform_vertices(REGS.RT, REGS.TR, vertices, 3, MAC);
+  RTPS(MAC[0], shift, lm, false);
+  RTPS(MAC[1], shift, lm, false);
+  RTPS(MAC[2], shift, lm, true);
 
   REGS.FLAG.UpdateError();
 }
@@ -0,0 +1,147 @@
+#pragma once
+#include "common/cpu_detect.h"
+#include "common/types.h"
+
+#if defined(CPU_X64)
+#if defined(_MSC_VER)
+#include <intrin.h>
+#define GTE_SSE41_FUNCTION
+#else
+#define GTE_SSE41_FUNCTION __attribute__((target("sse4.1")))
+#endif
+#include <smmintrin.h>
+#endif
+
+namespace GTE {
+
+/// Computes TR * 1000h + RT * V for each vertex, i.e. MAC1-3 of RTPS/RTPT before the shift. Returns the MAC1-3
+/// overflow/underflow FLAG bits, which are checked after each addition.
+using TransformVerticesFunction = u32 (*)(const s16 RT[3][3], const s32 TR[3], const s16* const V[], u32 count,
+                                          s64 out[][3]);
+
+ALWAYS_INLINE static void CheckTransformResult(s64 value, u32 row, u32* flags)
+{
+  if (value < -(INT64_C(1) << 43))
+    *flags |= UINT32_C(1) << (27 - row);
+  else if (value > ((INT64_C(1) << 43) - 1))
+    *flags |= UINT32_C(1) << (30 - row);
+}
+
+static inline u32 TransformVerticesScalar(const s16 RT[3][3], const s32 TR[3], const s16* const V[], u32 count,
+                                          s64 out[][3])
+{
+  u32 flags = 0;
+  for (u32 n = 0; n < count; n++)
+  {
+    for (u32 i = 0; i < 3; i++)
+    {
+      s64 value = (s64(TR[i]) << 12) + (s64(RT[i][0]) * s64(V[n][0]));
+      CheckTransformResult(value, i, &flags);
+      value = SignExtendN<44>(value) + (s64(RT[i][1]) * s64(V[n][1]));
+      CheckTransformResult(value, i, &flags);
+      value = SignExtendN<44>(value) + (s64(RT[i][2]) * s64(V[n][2]));
+      CheckTransformResult(value, i, &flags);
+      out[n][i] = value;
+    }
+  }
+
+  return flags;
+}
+
+#if defined(CPU_X64)
+
+ALWAYS_INLINE static bool CanUseTransformVerticesSSE41()
+{
+#if defined(_MSC_VER)
+  int info[4];
+  __cpuid(info, 1);
+  return (info[2] & (1 << 19)) != 0;
+#else
+  return __builtin_cpu_supports("sse4.1");
+#endif
+}
+
+/// Rows 1-2 are computed in one register and row 3 in another. The sums are kept biased by 2^43, so the 44-bit range
+/// check becomes a sign test, and the sign extension between additions is a mask.
+GTE_SSE41_FUNCTION static inline u32 TransformVerticesSSE41(const s16 RT[3][3], const s32 TR[3],
+                                                            const s16* const V[], u32 count, s64 out[][3])
+{
+  const __m128i bias = _mm_set1_epi64x(INT64_C(1) << 43);
+  const __m128i range = _mm_set1_epi64x(INT64_C(1) << 44);
+  const __m128i mask = _mm_set1_epi64x((INT64_C(1) << 44) - 1);
+  const __m128i tr_lo =
+    _mm_add_epi64(_mm_slli_epi64(_mm_cvtepi32_epi64(_mm_loadl_epi64(reinterpret_cast<const __m128i*>(TR))), 12), bias);
+  const __m128i tr_hi = _mm_add_epi64(_mm_slli_epi64(_mm_cvtepi32_epi64(_mm_cvtsi32_si128(TR[2])), 12), bias);
+
+  // _mm_mul_epi32 multiplies the even dwords, so each row's coefficient goes in the low half of its lane. The loads
+  // are {RT11,RT12,RT13,RT21}, {RT21,RT22,RT23,RT31} and {RT23,RT31,RT32,RT33}, which stay within the matrix.
+  const __m128i row0 = _mm_cvtepi16_epi32(_mm_loadl_epi64(reinterpret_cast<const __m128i*>(&RT[0][0])));
+  const __m128i row1 = _mm_cvtepi16_epi32(_mm_loadl_epi64(reinterpret_cast<const __m128i*>(&RT[1][0])));
+  const __m128i row2 = _mm_cvtepi16_epi32(_mm_loadl_epi64(reinterpret_cast<const __m128i*>(&RT[1][2])));
+  const __m128i rows01_lo = _mm_unpacklo_epi32(row0, row1);
+  const __m128i rows01_hi = _mm_unpackhi_epi32(row0, row1);
+  const __m128i rt_lo[3] = {_mm_shuffle_epi32(rows01_lo, _MM_SHUFFLE(1, 1, 0, 0)),
+                            _mm_shuffle_epi32(rows01_lo, _MM_SHUFFLE(3, 3, 2, 2)),
+                            _mm_shuffle_epi32(rows01_hi, _MM_SHUFFLE(1, 1, 0, 0))};
+  const __m128i rt_hi[3] = {_mm_srli_epi64(row2, 32), _mm_shuffle_epi32(row2, _MM_SHUFFLE(3, 2, 3, 2)),
+                            _mm_srli_si128(row2, 12)};
+
+  // A lane underflowed if any biased sum was negative, and overflowed if any was at or above 2^44.
+  __m128i under_lo = _mm_setzero_si128(), under_hi = _mm_setzero_si128();
+  __m128i over_lo = _mm_set1_epi32(-1), over_hi = _mm_set1_epi32(-1);
+
+#define add_column(j)                                                                                                  \
+  do                                                                                                                   \
+  {                                                                                                                    \
+    const __m128i v = _mm_set1_epi32(V[n][j]);                                                                         \
+    lo = _mm_add_epi64(lo, _mm_mul_epi32(rt_lo[j], v));                                                                \
+    hi = _mm_add_epi64(hi, _mm_mul_epi32(rt_hi[j], v));                                                                \
+    under_lo = _mm_or_si128(under_lo, lo);                                                                             \
+    under_hi = _mm_or_si128(under_hi, hi);                                                                             \
+    over_lo = _mm_and_si128(over_lo, _mm_sub_epi64(lo, range));                                                        \
+    over_hi = _mm_and_si128(over_hi, _mm_sub_epi64(hi, range));                                                        \
+  } while (0)
+
+  for (u32 n = 0; n < count; n++)
+  {
+    __m128i lo = tr_lo;
+    __m128i hi = tr_hi;
+    add_column(0);
+    lo = _mm_and_si128(lo, mask);
+    hi = _mm_and_si128(hi, mask);
+    add_column(1);
+    lo = _mm_and_si128(lo, mask);
+    hi = _mm_and_si128(hi, mask);
+    add_column(2);
+
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(&out[n][0]), _mm_sub_epi64(lo, bias));
+    out[n][2] = _mm_cvtsi128_si64(_mm_sub_epi64(hi, bias));
+  }
+
+#undef add_column
+
+  const u32 under = static_cast<u32>(_mm_movemask_pd(_mm_castsi128_pd(under_lo))) |
+                    (static_cast<u32>(_mm_movemask_pd(_mm_castsi128_pd(under_hi))) & 1u) << 2;
+  const u32 over = ~(static_cast<u32>(_mm_movemask_pd(_mm_castsi128_pd(over_lo))) |
+                     static_cast<u32>(_mm_movemask_pd(_mm_castsi128_pd(over_hi))) << 2) &
+                   7u;
+
+  // bit 0 is row 1, which is the highest FLAG bit
+  return ((under & 1u) << 27) | ((under & 2u) << 25) | ((under & 4u) << 23) | ((over & 1u) << 30) |
+         ((over & 2u) << 28) | ((over & 4u) << 26);
+}
+
+#endif
+
+/// Returns the fastest vertex transform the host supports.
+static inline TransformVerticesFunction GetTransformVerticesFunction()
+{
+#if defined(CPU_X64)
+  if (CanUseTransformVerticesSSE41())
+    return TransformVerticesSSE41;
+#endif
+
+  return TransformVerticesScalar;
+}
+
+} // namespace GTE
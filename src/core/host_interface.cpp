@@ -17,6 +17,7 @@
 #include "pgxp.h"
 #include "save_state_version.h"
 #include "system.h"
+#include "timing_event.h"
 #include <cmath>
 #include <cstring>
 #include <cwchar>
@@ -361,6 +362,15 @@ void HostInterface::SetDefaultSettings(SettingsInterface& si)
 
   si.SetStringValue("CPU", "ExecutionMode", Settings::GetCPUExecutionModeName(Settings::DEFAULT_CPU_EXECUTION_MODE));
   si.SetBoolValue("CPU", "RecompilerMemoryExceptions", false);
+  si.SetBoolValue("CPU", "Fastmem", false);
+  si.SetBoolValue("CPU", "CodePageProtection", false);
+  si.SetBoolValue("CPU", "RecompilerDiskCache", false);
+  si.SetBoolValue("CPU", "RecompilerSuperblocks", false);
+  si.SetBoolValue("CPU", "RecompilerTiered", false);
+  si.SetBoolValue("CPU", "RecompilerThread", false);
+  si.SetIntValue("CPU", "RecompilerCodeCacheSize", static_cast<int>(Settings::DEFAULT_CPU_RECOMPILER_CODE_CACHE_SIZE));
+  si.SetBoolValue("CPU", "RecompilerHostExtensions", true);
+  si.SetBoolValue("CPU", "IdleLoopSkipping", false);
 
   si.SetStringValue("GPU", "Renderer", Settings::GetRendererName(Settings::DEFAULT_GPU_RENDERER));
   si.SetIntValue("GPU", "ResolutionScale", 1);
@@ -426,6 +436,8 @@ void HostInterface::SetDefaultSettings(SettingsInterface& si)
   si.SetBoolValue("Debug", "ShowSPUState", false);
   si.SetBoolValue("Debug", "ShowTimersState", false);
   si.SetBoolValue("Debug", "ShowMDECState", false);
+  si.SetBoolValue("Debug", "ShowCodeCacheProfile", false);
+  si.SetBoolValue("Debug", "ShowTimingEventProfile", false);
 
   si.SetIntValue("Hacks", "DMAMaxSliceTicks", static_cast<int>(Settings::DEFAULT_DMA_MAX_SLICE_TICKS));
   si.SetIntValue("Hacks", "DMAHaltTicks", static_cast<int>(Settings::DEFAULT_DMA_HALT_TICKS));
@@ -485,6 +497,68 @@ void HostInterface::CheckForSettingsChanges(const Settings& old_settings)
       CPU::CodeCache::Flush();
     }
 
+    if (g_settings.cpu_execution_mode == CPUExecutionMode::Recompiler &&
+        g_settings.cpu_recompiler_superblocks != old_settings.cpu_recompiler_superblocks)
+    {
+      ReportFormattedMessage("Recompiler superblocks %s, flushing all blocks.",
+                             g_settings.cpu_recompiler_superblocks ? "enabled" : "disabled");
+      CPU::CodeCache::Flush();
+    }
+
+    if (g_settings.cpu_execution_mode == CPUExecutionMode::Recompiler &&
+        g_settings.cpu_recompiler_tiered != old_settings.cpu_recompiler_tiered)
+    {
+      ReportFormattedMessage("Tiered recompilation %s, flushing all blocks.",
+                             g_settings.cpu_recompiler_tiered ? "enabled" : "disabled");
+      CPU::CodeCache::Flush();
+    }
+
+    if (g_settings.cpu_execution_mode == CPUExecutionMode::Recompiler &&
+        g_settings.cpu_recompiler_thread != old_settings.cpu_recompiler_thread)
+    {
+      ReportFormattedMessage("Recompiler thread %s, flushing all blocks.",
+                             g_settings.cpu_recompiler_thread ? "enabled" : "disabled");
+      CPU::CodeCache::Flush();
+    }
+
+    if (g_settings.cpu_execution_mode == CPUExecutionMode::Recompiler &&
+        g_settings.cpu_recompiler_code_cache_size != old_settings.cpu_recompiler_code_cache_size)
+    {
+      ReportFormattedMessage("Code cache size changed to %u MB, flushing all blocks.",
+                             g_settings.cpu_recompiler_code_cache_size);
+      CPU::CodeCache::Flush();
+    }
+
+    if (g_settings.cpu_execution_mode == CPUExecutionMode::Recompiler &&
+        g_settings.cpu_recompiler_host_extensions != old_settings.cpu_recompiler_host_extensions)
+    {
+      ReportFormattedMessage("Recompiler host extensions %s, flushing all blocks.",
+                             g_settings.cpu_recompiler_host_extensions ? "enabled" : "disabled");
+      CPU::CodeCache::Flush();
+    }
+
+    if (g_settings.cpu_execution_mode != CPUExecutionMode::Interpreter &&
+        g_settings.cpu_idle_loop_skipping != old_settings.cpu_idle_loop_skipping)
+    {
+      ReportFormattedMessage("Idle loop skipping %s, flushing all blocks.",
+                             g_settings.cpu_idle_loop_skipping ? "enabled" : "disabled");
+      CPU::CodeCache::Flush();
+    }
+
+    if (g_settings.IsUsingFastmem() != old_settings.IsUsingFastmem())
+    {
+      ReportFormattedMessage("Fastmem %s, flushing all blocks.", g_settings.IsUsingFastmem() ? "enabled" : "disabled");
+      CPU::CodeCache::Flush();
+      CPU::UpdateFastmemMapping();
+    }
+
+    if (g_settings.cpu_code_page_protection != old_settings.cpu_code_page_protection)
+    {
+      ReportFormattedMessage("Code page protection %s, flushing all blocks.",
+                             g_settings.cpu_code_page_protection ? "enabled" : "disabled");
+      CPU::CodeCache::Flush();
+    }
+
     m_audio_stream->SetOutputVolume(g_settings.audio_output_muted ? 0 : g_settings.audio_output_volume);
 
     if (g_settings.gpu_resolution_scale != old_settings.gpu_resolution_scale ||
@@ -515,6 +589,8 @@ void HostInterface::CheckForSettingsChanges(const Settings& old_settings)
 
       if (g_settings.gpu_pgxp_enable)
         PGXP::Initialize();
+      else
+        PGXP::Shutdown();
     }
 
     if (g_settings.cdrom_read_thread != old_settings.cdrom_read_thread)
@@ -612,6 +688,33 @@ TinyString HostInterface::GetTimestampStringForFileName()
   return str;
 }
 
+bool HostInterface::SaveTimingEventProfile(const char* filename /* = nullptr */)
+{
+  if (!g_settings.debugging.show_timing_event_profile)
+  {
+    AddOSDMessage("Timing event profiling is not enabled.", 5.0f);
+    return false;
+  }
+
+  std::string auto_filename;
+  if (!filename)
+  {
+    FileSystem::CreateDirectory(GetUserDirectoryRelativePath("dump").c_str(), false);
+    auto_filename =
+      GetUserDirectoryRelativePath("dump/timing_events_%s.csv", GetTimestampStringForFileName().GetCharArray());
+    filename = auto_filename.c_str();
+  }
+
+  if (!TimingEvents::WriteProfileCSV(filename))
+  {
+    AddFormattedOSDMessage(10.0f, "Failed to save timing event profile to '%s'.", filename);
+    return false;
+  }
+
+  AddFormattedOSDMessage(5.0f, "Timing event profile saved to '%s'.", filename);
+  return true;
+}
+
 std::string HostInterface::GetSharedMemoryCardPath(u32 slot) const
 {
   return GetUserDirectoryRelativePath("memcards/shared_card_%d.mcd", slot + 1);
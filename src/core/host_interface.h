@@ -112,6 +112,10 @@ public:
   /// Loads the BIOS image for the specified region.
   std::optional<std::vector<u8>> GetBIOSImage(ConsoleRegion region);
 
+  /// Writes the timing event profile to a CSV file. If no file name is provided, a timestamped one in the dump
+  /// directory is used, so earlier captures aren't overwritten.
+  bool SaveTimingEventProfile(const char* filename = nullptr);
+
   virtual void OnRunningGameChanged();
   virtual void OnSystemPerformanceCountersUpdated();
 
@@ -19,9 +19,20 @@
  ***************************************************************************/
 
 #include "pgxp.h"
+#include "common/assert.h"
 #include "settings.h"
 #include <cmath>
 
+#if defined(WIN32)
+#include "common/windows_headers.h"
+#include <algorithm>
+#include <bitset>
+#elif defined(__linux__) || defined(__ANDROID__) || defined(__APPLE__)
+#include <sys/mman.h>
+#else
+#include <cstdlib>
+#endif
+
 namespace PGXP {
 // pgxp_types.h
 typedef struct PGXP_value_Tag
@@ -152,15 +163,79 @@ void MaskValidate(PGXP_value* pV, u32 psxV, u32 mask, u32 validMask)
 
 // pgxp_mem.c
 static void PGXP_InitMem();
-static PGXP_value Mem[3 * 2048 * 1024 / 4]; // mirror 2MB in 32-bit words * 3
+static void PGXP_FreeMem();
 static const u32 UserMemOffset = 0;
 static const u32 ScratchOffset = 2048 * 1024 / 4;
 static const u32 RegisterOffset = 2 * 2048 * 1024 / 4;
 static const u32 InvalidAddress = 3 * 2048 * 1024 / 4;
+static constexpr size_t MemSize = sizeof(PGXP_value) * InvalidAddress;
+
+// Mirror of 2MB in 32-bit words * 3. Allocated only while PGXP is enabled, and the OS only backs the pages which are
+// touched, so most of it is never resident.
+static PGXP_value* Mem = nullptr;
+
+#if defined(WIN32)
+// Windows charges committed pages against the commit limit whether or not they're touched, so the mapping is only
+// reserved, and committed a chunk at a time as it's accessed.
+static constexpr size_t MemCommitChunkSize = 64 * 1024;
+static constexpr size_t MemCommitChunkCount = (MemSize + MemCommitChunkSize - 1) / MemCommitChunkSize;
+static std::bitset<MemCommitChunkCount> MemCommittedChunks;
+
+static void PGXP_CommitMem(u32 index)
+{
+  // values can straddle a chunk boundary
+  const size_t first_chunk = (index * sizeof(PGXP_value)) / MemCommitChunkSize;
+  const size_t last_chunk = ((index + 1) * sizeof(PGXP_value) - 1) / MemCommitChunkSize;
+  for (size_t chunk = first_chunk; chunk <= last_chunk; chunk++)
+  {
+    if (MemCommittedChunks[chunk])
+      continue;
+
+    const size_t offset = chunk * MemCommitChunkSize;
+    if (!VirtualAlloc(reinterpret_cast<u8*>(Mem) + offset, std::min(MemCommitChunkSize, MemSize - offset), MEM_COMMIT,
+                      PAGE_READWRITE))
+    {
+      Panic("Failed to commit PGXP memory");
+    }
+
+    MemCommittedChunks.set(chunk);
+  }
+}
+#endif
 
 void PGXP_InitMem()
 {
-  memset(Mem, 0, sizeof(Mem));
+  // Fresh mappings are zero-filled, so replacing the whole thing is cheaper than clearing it.
+  PGXP_FreeMem();
+
+#if defined(WIN32)
+  Mem = static_cast<PGXP_value*>(VirtualAlloc(nullptr, MemSize, MEM_RESERVE, PAGE_READWRITE));
+#elif defined(__linux__) || defined(__ANDROID__) || defined(__APPLE__)
+  void* ptr = mmap(nullptr, MemSize, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+  Mem = (ptr != MAP_FAILED) ? static_cast<PGXP_value*>(ptr) : nullptr;
+#else
+  Mem = static_cast<PGXP_value*>(std::calloc(InvalidAddress, sizeof(PGXP_value)));
+#endif
+
+  if (!Mem)
+    Panic("Failed to allocate PGXP memory");
+}
+
+void PGXP_FreeMem()
+{
+  if (!Mem)
+    return;
+
+#if defined(WIN32)
+  VirtualFree(Mem, 0, MEM_RELEASE);
+  MemCommittedChunks.reset();
+#elif defined(__linux__) || defined(__ANDROID__) || defined(__APPLE__)
+  munmap(Mem, MemSize);
+#else
+  std::free(Mem);
+#endif
+
+  Mem = nullptr;
 }
 
 u32 PGXP_ConvertAddress(u32 addr)
@@ -210,8 +285,13 @@ PGXP_value* GetPtr(u32 addr)
 {
   addr = PGXP_ConvertAddress(addr);
 
-  if (addr != InvalidAddress)
+  if (addr != InvalidAddress && Mem)
+  {
+#if defined(WIN32)
+    PGXP_CommitMem(addr);
+#endif
     return &Mem[addr];
+  }
   return NULL;
 }
 
@@ -332,6 +412,11 @@ void Initialize()
   PGXP_InitGTE();
 }
 
+void Shutdown()
+{
+  PGXP_FreeMem();
+}
+
 void PGXP_SetModes(u32 modes)
 {
   gMode = modes;
@@ -25,6 +25,9 @@ namespace PGXP {
 
 void Initialize();
 
+/// Releases the shadow memory. Initialize() must be called again before PGXP is used.
+void Shutdown();
+
 // -- GTE functions
 // Transforms
 void GTE_PushSXYZ2f(float _x, float _y, float _z, unsigned int _v);
@@ -90,6 +90,16 @@ void Settings::Load(SettingsInterface& si)
       si.GetStringValue("CPU", "ExecutionMode", GetCPUExecutionModeName(DEFAULT_CPU_EXECUTION_MODE)).c_str())
       .value_or(DEFAULT_CPU_EXECUTION_MODE);
   cpu_recompiler_memory_exceptions = si.GetBoolValue("CPU", "RecompilerMemoryExceptions", false);
+  cpu_fastmem = si.GetBoolValue("CPU", "Fastmem", false);
+  cpu_code_page_protection = si.GetBoolValue("CPU", "CodePageProtection", false);
+  cpu_recompiler_disk_cache = si.GetBoolValue("CPU", "RecompilerDiskCache", false);
+  cpu_recompiler_superblocks = si.GetBoolValue("CPU", "RecompilerSuperblocks", false);
+  cpu_recompiler_tiered = si.GetBoolValue("CPU", "RecompilerTiered", false);
+  cpu_recompiler_thread = si.GetBoolValue("CPU", "RecompilerThread", false);
+  cpu_recompiler_code_cache_size = static_cast<u32>(
+    si.GetIntValue("CPU", "RecompilerCodeCacheSize", DEFAULT_CPU_RECOMPILER_CODE_CACHE_SIZE));
+  cpu_recompiler_host_extensions = si.GetBoolValue("CPU", "RecompilerHostExtensions", true);
+  cpu_idle_loop_skipping = si.GetBoolValue("CPU", "IdleLoopSkipping", false);
 
   gpu_renderer = ParseRendererName(si.GetStringValue("GPU", "Renderer", GetRendererName(DEFAULT_GPU_RENDERER)).c_str())
                    .value_or(DEFAULT_GPU_RENDERER);
@@ -181,6 +191,8 @@ void Settings::Load(SettingsInterface& si)
   debugging.show_spu_state = si.GetBoolValue("Debug", "ShowSPUState");
   debugging.show_timers_state = si.GetBoolValue("Debug", "ShowTimersState");
   debugging.show_mdec_state = si.GetBoolValue("Debug", "ShowMDECState");
+  debugging.show_code_cache_profile = si.GetBoolValue("Debug", "ShowCodeCacheProfile");
+  debugging.show_timing_event_profile = si.GetBoolValue("Debug", "ShowTimingEventProfile");
 }
 
 void Settings::Save(SettingsInterface& si) const
@@ -198,6 +210,15 @@ void Settings::Save(SettingsInterface& si) const
 
   si.SetStringValue("CPU", "ExecutionMode", GetCPUExecutionModeName(cpu_execution_mode));
   si.SetBoolValue("CPU", "RecompilerMemoryExceptions", cpu_recompiler_memory_exceptions);
+  si.SetBoolValue("CPU", "Fastmem", cpu_fastmem);
+  si.SetBoolValue("CPU", "CodePageProtection", cpu_code_page_protection);
+  si.SetBoolValue("CPU", "RecompilerDiskCache", cpu_recompiler_disk_cache);
+  si.SetBoolValue("CPU", "RecompilerSuperblocks", cpu_recompiler_superblocks);
+  si.SetBoolValue("CPU", "RecompilerTiered", cpu_recompiler_tiered);
+  si.SetBoolValue("CPU", "RecompilerThread", cpu_recompiler_thread);
+  si.SetIntValue("CPU", "RecompilerCodeCacheSize", static_cast<int>(cpu_recompiler_code_cache_size));
+  si.SetBoolValue("CPU", "RecompilerHostExtensions", cpu_recompiler_host_extensions);
+  si.SetBoolValue("CPU", "IdleLoopSkipping", cpu_idle_loop_skipping);
 
   si.SetStringValue("GPU", "Renderer", GetRendererName(gpu_renderer));
   si.SetStringValue("GPU", "Adapter", gpu_adapter.c_str());
@@ -274,6 +295,8 @@ void Settings::Save(SettingsInterface& si) const
   si.SetBoolValue("Debug", "ShowSPUState", debugging.show_spu_state);
   si.SetBoolValue("Debug", "ShowTimersState", debugging.show_timers_state);
   si.SetBoolValue("Debug", "ShowMDECState", debugging.show_mdec_state);
+  si.SetBoolValue("Debug", "ShowCodeCacheProfile", debugging.show_code_cache_profile);
+  si.SetBoolValue("Debug", "ShowTimingEventProfile", debugging.show_timing_event_profile);
 }
 
 static std::array<const char*, LOGLEVEL_COUNT> s_log_level_names = {
@@ -69,6 +69,15 @@ struct Settings
 
   CPUExecutionMode cpu_execution_mode = CPUExecutionMode::Interpreter;
   bool cpu_recompiler_memory_exceptions = false;
+  bool cpu_fastmem = false;
+  bool cpu_code_page_protection = false;
+  bool cpu_recompiler_disk_cache = false;
+  bool cpu_recompiler_superblocks = false;
+  bool cpu_recompiler_tiered = false;
+  bool cpu_recompiler_thread = false;
+  u32 cpu_recompiler_code_cache_size = 64;
+  bool cpu_recompiler_host_extensions = true;
+  bool cpu_idle_loop_skipping = false;
 
   float emulation_speed = 1.0f;
   bool speed_limiter_enabled = true;
@@ -132,6 +141,10 @@ struct Settings
     mutable bool show_spu_state = false;
     mutable bool show_timers_state = false;
     mutable bool show_mdec_state = false;
+
+    // Also enables block profiling in the code cache, which stops blocks being linked.
+    mutable bool show_code_cache_profile = false;
+    mutable bool show_timing_event_profile = false;
   } debugging;
 
   // TODO: Controllers, memory cards, etc.
@@ -153,6 +166,11 @@ struct Settings
 
   ALWAYS_INLINE bool IsUsingCodeCache() const { return (cpu_execution_mode != CPUExecutionMode::Interpreter); }
   ALWAYS_INLINE bool IsUsingRecompiler() const { return (cpu_execution_mode == CPUExecutionMode::Recompiler); }
+  ALWAYS_INLINE bool IsUsingFastmem() const
+  {
+    // Fastmem loads/stores can't raise guest exceptions, so they're incompatible with memory exceptions.
+    return (cpu_fastmem && cpu_execution_mode == CPUExecutionMode::Recompiler && !cpu_recompiler_memory_exceptions);
+  }
   ALWAYS_INLINE bool IsUsingSoftwareRenderer() const { return (gpu_renderer == GPURenderer::Software); }
 
   bool HasAnyPerGameMemoryCards() const;
@@ -162,7 +180,8 @@ struct Settings
     DEFAULT_DMA_MAX_SLICE_TICKS = 1000,
     DEFAULT_DMA_HALT_TICKS = 100,
     DEFAULT_GPU_FIFO_SIZE = 16,
-    DEFAULT_GPU_MAX_RUN_AHEAD = 128
+    DEFAULT_GPU_MAX_RUN_AHEAD = 128,
+    DEFAULT_CPU_RECOMPILER_CODE_CACHE_SIZE = 64
   };
 
   void Load(SettingsInterface& si);
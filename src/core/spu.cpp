@@ -20,10 +20,16 @@ SPU::~SPU() = default;
 void SPU::Initialize()
 {
   m_tick_event = TimingEvents::CreateTimingEvent("SPU Sample", SYSCLK_TICKS_PER_SPU_TICK, SYSCLK_TICKS_PER_SPU_TICK,
-                                                 std::bind(&SPU::Execute, this, std::placeholders::_1), false);
+                                                 [](void* param, TickCount ticks, TickCount ticks_late) {
+                                                   static_cast<SPU*>(param)->Execute(ticks);
+                                                 },
+                                                 this, false);
   m_transfer_event =
     TimingEvents::CreateTimingEvent("SPU Transfer", TRANSFER_TICKS_PER_HALFWORD, TRANSFER_TICKS_PER_HALFWORD,
-                                    std::bind(&SPU::ExecuteTransfer, this, std::placeholders::_1), false);
+                                    [](void* param, TickCount ticks, TickCount ticks_late) {
+                                      static_cast<SPU*>(param)->ExecuteTransfer(ticks);
+                                    },
+                                    this, false);
 
   Reset();
 }
@@ -331,6 +337,7 @@ void SPU::WriteRegister(u32 offset, u16 value)
       Log_DebugPrintf("SPU key on low <- 0x%04X", ZeroExtend32(value));
       m_tick_event->InvokeEarly();
       m_key_on_register = (m_key_on_register & 0xFFFF0000) | ZeroExtend32(value);
+      ScheduleIRQCheck();
     }
     break;
 
@@ -339,6 +346,7 @@ void SPU::WriteRegister(u32 offset, u16 value)
       Log_DebugPrintf("SPU key on high <- 0x%04X", ZeroExtend32(value));
       m_tick_event->InvokeEarly();
       m_key_on_register = (m_key_on_register & 0x0000FFFF) | (ZeroExtend32(value) << 16);
+      ScheduleIRQCheck();
     }
     break;
 
@@ -414,6 +422,7 @@ void SPU::WriteRegister(u32 offset, u16 value)
       m_reverb_registers.mBASE = value;
       m_reverb_base_address = ZeroExtend32(value << 2) & 0x3FFFFu;
       m_reverb_current_address = m_reverb_base_address;
+      ScheduleIRQCheck();
     }
     break;
 
@@ -422,6 +431,7 @@ void SPU::WriteRegister(u32 offset, u16 value)
       Log_DebugPrintf("SPU IRQ address register <- 0x%04X", ZeroExtend32(value));
       m_tick_event->InvokeEarly();
       m_irq_address = value;
+      ScheduleIRQCheck();
       return;
     }
 
@@ -570,8 +580,9 @@ void SPU::WriteVoiceRegister(u32 offset, u16 value)
   const u32 voice_index = (offset / 0x10);
   Assert(voice_index < 24);
 
+  // Voices which are off still read blocks when IRQs are enabled.
   Voice& voice = m_voices[voice_index];
-  if (voice.IsOn() || m_key_on_register & (1u << voice_index))
+  if (voice.IsOn() || m_key_on_register & (1u << voice_index) || m_SPUCNT.irq9_enable)
     m_tick_event->InvokeEarly();
 
   switch (reg_index)
@@ -603,6 +614,7 @@ void SPU::WriteVoiceRegister(u32 offset, u16 value)
     {
       Log_DebugPrintf("SPU voice %u ADPCM start address <- 0x%04X", voice_index, value);
       voice.regs.adpcm_start_address = value;
+      ScheduleIRQCheck();
     }
     break;
 
@@ -636,6 +648,7 @@ void SPU::WriteVoiceRegister(u32 offset, u16 value)
       Log_DebugPrintf("SPU voice %u ADPCM repeat address <- 0x%04X", voice_index, value);
       voice.regs.adpcm_repeat_address = value;
       voice.ignore_loop_address = true;
+      ScheduleIRQCheck();
     }
     break;
 
@@ -783,6 +796,8 @@ void SPU::Execute(TickCount ticks)
     output_stream->EndWrite(frames_in_this_batch);
     remaining_frames -= frames_in_this_batch;
   }
+
+  ScheduleIRQCheck();
 }
 
 void SPU::UpdateEventInterval()
@@ -792,16 +807,117 @@ void SPU::UpdateEventInterval()
   // the SPU state.
   const u32 max_slice_frames = g_host_interface->GetAudioStream()->GetBufferSize();
 
-  // TODO: Make this predict how long until the interrupt will be hit instead...
-  const u32 interval = (m_SPUCNT.enable && m_SPUCNT.irq9_enable) ? 1 : max_slice_frames;
-  const TickCount interval_ticks = static_cast<TickCount>(interval) * SYSCLK_TICKS_PER_SPU_TICK;
-  if (m_tick_event->IsActive() && m_tick_event->GetInterval() == interval_ticks)
+  const TickCount interval_ticks = static_cast<TickCount>(max_slice_frames) * SYSCLK_TICKS_PER_SPU_TICK;
+  if (!m_tick_event->IsActive() || m_tick_event->GetInterval() != interval_ticks)
+  {
+    // Ensure all pending ticks have been executed, since we won't get them back after rescheduling.
+    m_tick_event->InvokeEarly(true);
+    m_tick_event->SetInterval(interval_ticks);
+    m_tick_event->Schedule(interval_ticks - m_ticks_carry);
+  }
+
+  // With IRQs enabled, the slice is cut short instead of running every frame.
+  ScheduleIRQCheck();
+}
+
+u32 SPU::GetFramesUntilPossibleIRQ(u32 max_frames) const
+{
+  const u32 irq_address = ZeroExtend32(m_irq_address) * 8;
+  u32 frames = max_frames;
+
+  // The capture buffers are written every frame, at the same offset in each channel.
+  if (irq_address < (CAPTURE_BUFFER_SIZE_PER_CHANNEL * 4))
+  {
+    const u32 offset = (irq_address - ZeroExtend32(m_capture_buffer_position)) % CAPTURE_BUFFER_SIZE_PER_CHANNEL;
+    frames = std::min<u32>(frames, offset / sizeof(s16) + 1);
+  }
+
+  // Reading a block checks the IRQ address against both of its halves.
+  const auto block_hits_irq_address = [irq_address](u16 address) {
+    const u32 ram_address = (ZeroExtend32(address) * 8) & RAM_MASK;
+    return (ram_address == irq_address || ((ram_address + 8) & RAM_MASK) == irq_address);
+  };
+
+  // Blocks in the capture buffers or reverb work area can be rewritten while the slice runs, so the voice can only be
+  // followed through the RAM between them.
+  const u32 stable_start = CAPTURE_BUFFER_SIZE_PER_CHANNEL * 4;
+  const u32 stable_end = m_reverb_base_address * 2;
+
+  for (u32 i = 0; i < NUM_VOICES && frames > 1; i++)
+  {
+    // Key on takes effect after the voice is sampled, but resets its address.
+    if (m_key_on_register & (1u << i))
+      return 1;
+
+    const Voice& voice = m_voices[i];
+    u16 address = voice.current_address;
+    u16 repeat_address = voice.regs.adpcm_repeat_address;
+    ADPCMFlags flags = voice.current_block_flags;
+    if (!voice.has_samples)
+    {
+      // The current block is read on the next frame, before anything in the slice can write to RAM.
+      if (block_hits_irq_address(address))
+        return 1;
+
+      flags.bits = m_ram[(ZeroExtend32(address) * 8 + 1) & RAM_MASK];
+      if (flags.loop_start && !voice.ignore_loop_address)
+        repeat_address = address;
+    }
+
+    // The next block is read on the frame after the counter passes the end of the current one.
+    const u32 block_end = NUM_SAMPLES_PER_ADPCM_BLOCK << 12;
+    const u32 remaining = block_end - std::min(voice.counter.bits & 0x1FFFF, block_end);
+    u32 read_frame = 1 + (remaining + 0x3FFE) / 0x3FFF;
+
+    // Follow the blocks the voice will play, using their flags in RAM.
+    for (;;)
+    {
+      if (flags.loop_end && flags.loop_repeat)
+        address = repeat_address & ~u16(1);
+      else
+        address += 2;
+
+      if (read_frame >= frames)
+        break;
+
+      if (block_hits_irq_address(address))
+      {
+        frames = read_frame;
+        break;
+      }
+
+      const u32 flags_address = (ZeroExtend32(address) * 8 + 1) & RAM_MASK;
+      if (flags_address < stable_start || flags_address >= stable_end)
+      {
+        frames = std::min(frames, read_frame + MIN_FRAMES_PER_ADPCM_BLOCK);
+        break;
+      }
+
+      flags.bits = m_ram[flags_address];
+      if (flags.loop_start && !voice.ignore_loop_address)
+        repeat_address = address;
+
+      read_frame += MIN_FRAMES_PER_ADPCM_BLOCK;
+    }
+  }
+
+  return frames;
+}
+
+void SPU::ScheduleIRQCheck()
+{
+  if (!m_SPUCNT.enable || !m_SPUCNT.irq9_enable || !m_tick_event->IsActive())
     return;
 
-  // Ensure all pending ticks have been executed, since we won't get them back after rescheduling.
-  m_tick_event->InvokeEarly(true);
-  m_tick_event->SetInterval(interval_ticks);
-  m_tick_event->Schedule(interval_ticks - m_ticks_carry);
+  // Frames are counted from the last time the SPU was run, some of them may be pending already.
+  const TickCount pending_ticks = m_tick_event->GetTicksSinceLastExecution() + m_ticks_carry;
+  const TickCount ticks =
+    static_cast<TickCount>(GetFramesUntilPossibleIRQ(MAX_IRQ_LOOKAHEAD_FRAMES) * SYSCLK_TICKS_PER_SPU_TICK) -
+    pending_ticks;
+  if (ticks <= 0)
+    m_tick_event->InvokeEarly(true);
+  else if (ticks < m_tick_event->GetTicksUntilNextExecution())
+    m_tick_event->Schedule(ticks);
 }
 
 void SPU::ExecuteTransfer(TickCount ticks)
@@ -841,6 +957,10 @@ void SPU::ExecuteTransfer(TickCount ticks)
   }
   else
   {
+    // Voices have to see RAM as it was before the write. Following blocks may have changed, so the IRQ check is redone.
+    if (m_SPUCNT.irq9_enable)
+      m_tick_event->InvokeEarly();
+
     // write the fifo to ram, request dma again when empty
     while (ticks > 0 && !m_transfer_fifo.IsEmpty())
     {
@@ -856,6 +976,8 @@ void SPU::ExecuteTransfer(TickCount ticks)
       UpdateDMARequest();
     }
 
+    ScheduleIRQCheck();
+
     // we're done if we have no more data to write
     if (m_transfer_fifo.IsEmpty())
     {
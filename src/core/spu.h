@@ -63,6 +63,12 @@ private:
   static constexpr u32 FIFO_SIZE_IN_HALFWORDS = 32;
   static constexpr TickCount TRANSFER_TICKS_PER_HALFWORD = 32;
 
+  // At the maximum step of 3FFFh per frame, a voice still takes this long to play a block, even with the carry-over.
+  static constexpr u32 MIN_FRAMES_PER_ADPCM_BLOCK = 7;
+
+  // How far ahead to look for frames which could raise an IRQ. Bounds the cost of rescheduling.
+  static constexpr u32 MAX_IRQ_LOOKAHEAD_FRAMES = 256;
+
   enum class RAMTransferMode : u8
   {
     Stopped = 0,
@@ -361,6 +367,13 @@ private:
   void Execute(TickCount ticks);
   void UpdateEventInterval();
 
+  /// Returns a lower bound on the number of frames until a voice or capture buffer access could hit the IRQ address,
+  /// including the frame that does it. Ignores anything further away than max_frames.
+  u32 GetFramesUntilPossibleIRQ(u32 max_frames) const;
+
+  /// Moves the tick event earlier if an IRQ could be raised before it would otherwise run.
+  void ScheduleIRQCheck();
+
   void ExecuteTransfer(TickCount ticks);
   void ManualTransferWrite(u16 value);
   void UpdateTransferEvent();
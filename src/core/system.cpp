@@ -417,6 +417,7 @@ bool Boot(const SystemBootParameters& params)
 
   // Load the patched BIOS up.
   Bus::SetBIOS(*bios_image);
+  CPU::CodeCache::OpenDiskCache(bios_hash);
 
   // Good to go.
   s_state = State::Running;
@@ -452,7 +453,8 @@ bool Initialize(bool force_software_renderer)
 
   CPU::Initialize();
   CPU::CodeCache::Initialize(g_settings.cpu_execution_mode == CPUExecutionMode::Recompiler);
-  Bus::Initialize();
+  if (!Bus::Initialize())
+    return false;
 
   if (!CreateGPU(force_software_renderer ? GPURenderer::Software : g_settings.gpu_renderer))
     return false;
@@ -822,6 +824,9 @@ void RunFrame()
   // Generate any pending samples from the SPU before sleeping, this way we reduce the chances of underruns.
   g_spu.GeneratePendingSamples();
 
+  if (g_settings.debugging.show_timing_event_profile)
+    TimingEvents::EndProfileFrame();
+
   g_gpu->ResetGraphicsAPIState();
 }
 
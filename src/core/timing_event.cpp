@@ -1,24 +1,49 @@
 #include "timing_event.h"
 #include "common/assert.h"
+#include "common/bitutils.h"
+#include "common/file_system.h"
 #include "common/log.h"
 #include "common/state_wrapper.h"
+#include "common/timer.h"
 #include "cpu_core.h"
+#include "host_interface.h"
+#include "settings.h"
 #include "system.h"
+#include <algorithm>
+#include <cstdio>
+#include <imgui.h>
+#include <map>
 Log_SetChannel(TimingEvents);
 
 namespace TimingEvents {
 
+// Active events are kept in a binary min-heap ordered by their next run time. Each event knows its own position in the
+// heap, so adding, removing and rescheduling events are all O(log n).
 static std::vector<TimingEvent*> s_events;
 static u32 s_global_tick_counter = 0;
 static u32 s_last_event_run_time = 0;
 static bool s_running_events = false;
-static bool s_events_need_sorting = false;
+
+static std::map<std::string, TimingEventProfile> s_event_profiles;
+static u32 s_profile_frame_count = 0;
 
 u32 GetGlobalTickCounter()
 {
   return s_global_tick_counter;
 }
 
+static void RebaseEvents(u32 new_global_tick_counter)
+{
+  const u32 delta = new_global_tick_counter - s_global_tick_counter;
+  for (TimingEvent* evt : s_events)
+  {
+    evt->m_next_run_time += delta;
+    evt->m_last_run_time += delta;
+  }
+
+  s_global_tick_counter = new_global_tick_counter;
+}
+
 void Initialize()
 {
   Reset();
@@ -26,7 +51,7 @@ void Initialize()
 
 void Reset()
 {
-  s_global_tick_counter = 0;
+  RebaseEvents(0);
   s_last_event_run_time = 0;
 }
 
@@ -36,10 +61,10 @@ void Shutdown()
 }
 
 std::unique_ptr<TimingEvent> CreateTimingEvent(std::string name, TickCount period, TickCount interval,
-                                               TimingEventCallback callback, bool activate)
+                                               TimingEventCallback callback, void* callback_param, bool activate)
 {
   std::unique_ptr<TimingEvent> event =
-    std::make_unique<TimingEvent>(std::move(name), period, interval, std::move(callback));
+    std::make_unique<TimingEvent>(std::move(name), period, interval, callback, callback_param);
   if (activate)
     event->Activate();
 
@@ -52,45 +77,102 @@ void UpdateCPUDowncount()
     CPU::g_state.downcount = s_events[0]->GetDowncount();
 }
 
-static bool CompareEvents(const TimingEvent* lhs, const TimingEvent* rhs)
+ALWAYS_INLINE static bool IsEarlier(const TimingEvent* lhs, const TimingEvent* rhs)
 {
-  return lhs->GetDowncount() > rhs->GetDowncount();
+  // the tick counter wraps, so compare the difference rather than the values
+  return static_cast<s32>(lhs->m_next_run_time - rhs->m_next_run_time) < 0;
 }
 
-static void AddActiveEvent(TimingEvent* event)
+ALWAYS_INLINE static void SetHeapEntry(u32 index, TimingEvent* event)
 {
-  s_events.push_back(event);
-  if (!s_running_events)
+  s_events[index] = event;
+  event->m_heap_index = index;
+}
+
+static void SiftUp(u32 index)
+{
+  TimingEvent* event = s_events[index];
+  while (index > 0)
   {
-    std::push_heap(s_events.begin(), s_events.end(), CompareEvents);
-    UpdateCPUDowncount();
+    const u32 parent = (index - 1) / 2;
+    if (!IsEarlier(event, s_events[parent]))
+      break;
+
+    SetHeapEntry(index, s_events[parent]);
+    index = parent;
   }
-  else
+
+  SetHeapEntry(index, event);
+}
+
+static void SiftDown(u32 index)
+{
+  TimingEvent* event = s_events[index];
+  const u32 count = static_cast<u32>(s_events.size());
+  for (;;)
   {
-    s_events_need_sorting = true;
+    u32 child = index * 2 + 1;
+    if (child >= count)
+      break;
+    if ((child + 1) < count && IsEarlier(s_events[child + 1], s_events[child]))
+      child++;
+    if (!IsEarlier(s_events[child], event))
+      break;
+
+    SetHeapEntry(index, s_events[child]);
+    index = child;
   }
+
+  SetHeapEntry(index, event);
+}
+
+/// Moves the event to the correct position after its next run time has changed.
+static void UpdateEventPosition(TimingEvent* event)
+{
+  const u32 index = event->m_heap_index;
+  if (index > 0 && IsEarlier(event, s_events[(index - 1) / 2]))
+    SiftUp(index);
+  else
+    SiftDown(index);
+}
+
+static void AddActiveEvent(TimingEvent* event)
+{
+  const u32 index = static_cast<u32>(s_events.size());
+  s_events.push_back(event);
+  event->m_heap_index = index;
+  SiftUp(index);
+
+  if (!s_running_events)
+    UpdateCPUDowncount();
 }
 
 static void RemoveActiveEvent(TimingEvent* event)
 {
-  auto iter = std::find_if(s_events.begin(), s_events.end(), [event](const auto& it) { return event == it; });
-  if (iter == s_events.end())
+  const u32 index = event->m_heap_index;
+  if (index >= s_events.size() || s_events[index] != event)
   {
     Panic("Attempt to remove inactive event");
     return;
   }
 
-  s_events.erase(iter);
-  if (!s_running_events)
+  TimingEvent* last = s_events.back();
+  s_events.pop_back();
+  if (last != event)
   {
-    std::make_heap(s_events.begin(), s_events.end(), CompareEvents);
-    if (!s_events.empty())
-      UpdateCPUDowncount();
-  }
-  else
-  {
-    s_events_need_sorting = true;
+    SetHeapEntry(index, last);
+    UpdateEventPosition(last);
   }
+
+  if (!s_running_events && !s_events.empty())
+    UpdateCPUDowncount();
+}
+
+static void RescheduleEvent(TimingEvent* event)
+{
+  UpdateEventPosition(event);
+  if (!s_running_events)
+    UpdateCPUDowncount();
 }
 
 static TimingEvent* FindActiveEvent(const char* name)
@@ -103,15 +185,46 @@ static TimingEvent* FindActiveEvent(const char* name)
 
 static void SortEvents()
 {
+  for (u32 i = static_cast<u32>(s_events.size()) / 2; i > 0; i--)
+    SiftDown(i - 1);
+  for (u32 i = 0; i < static_cast<u32>(s_events.size()); i++)
+    s_events[i]->m_heap_index = i;
+
   if (!s_running_events)
-  {
-    std::make_heap(s_events.begin(), s_events.end(), CompareEvents);
     UpdateCPUDowncount();
-  }
+}
+
+static u32 GetLatenessBucket(TickCount ticks_late)
+{
+  if (ticks_late <= 0)
+    return 0;
+
+  const u32 bucket = 32 - CountLeadingZeros(static_cast<u32>(ticks_late));
+  return std::min(bucket, TimingEventProfile::NUM_LATENESS_BUCKETS - 1);
+}
+
+static void InvokeProfiledCallback(TimingEvent* event, TickCount ticks, TickCount ticks_late)
+{
+  if (!event->m_profile)
+    event->m_profile = &s_event_profiles[event->GetName()];
+
+  const Common::Timer::Value start_time = Common::Timer::GetValue();
+  event->m_callback(event->m_callback_param, ticks, ticks_late);
+
+  // The event can't be destroyed by its own callback, so the profile is still valid.
+  TimingEventProfile* profile = event->m_profile;
+  profile->host_time += Common::Timer::GetValue() - start_time;
+  profile->invocation_count++;
+  profile->frame_invocation_count++;
+  profile->lateness_histogram[GetLatenessBucket(ticks_late)]++;
+}
+
+ALWAYS_INLINE static void InvokeCallback(TimingEvent* event, TickCount ticks, TickCount ticks_late)
+{
+  if (g_settings.debugging.show_timing_event_profile)
+    InvokeProfiledCallback(event, ticks, ticks_late);
   else
-  {
-    s_events_need_sorting = true;
-  }
+    event->m_callback(event->m_callback_param, ticks, ticks_late);
 }
 
 void RunEvents()
@@ -120,51 +233,33 @@ void RunEvents()
 
   s_running_events = true;
 
-  TickCount pending_ticks = (s_global_tick_counter + CPU::GetPendingTicks()) - s_last_event_run_time;
+  const TickCount pending_ticks = (s_global_tick_counter + CPU::GetPendingTicks()) - s_last_event_run_time;
   CPU::ResetPendingTicks();
-  while (pending_ticks > 0)
+  if (pending_ticks > 0)
   {
-    const TickCount time = std::min(pending_ticks, s_events[0]->GetDowncount());
-    s_global_tick_counter += static_cast<u32>(time);
-    pending_ticks -= time;
-
-    // Apply downcount to all events.
-    // This will result in a negative downcount for those events which are late.
-    for (TimingEvent* evt : s_events)
-    {
-      evt->m_downcount -= time;
-      evt->m_time_since_last_run += time;
-    }
-
-    // Now we can actually run the callbacks.
-    while (s_events.front()->m_downcount <= 0)
+    const u32 target_time = s_global_tick_counter + static_cast<u32>(pending_ticks);
+    for (;;)
     {
       TimingEvent* evt = s_events.front();
-      std::pop_heap(s_events.begin(), s_events.end(), CompareEvents);
+      if (static_cast<s32>(evt->m_next_run_time - target_time) > 0)
+        break;
+
+      // Events which are already late don't move time backwards.
+      if (static_cast<s32>(evt->m_next_run_time - s_global_tick_counter) > 0)
+        s_global_tick_counter = evt->m_next_run_time;
 
       // Factor late time into the time for the next invocation.
-      const TickCount ticks_late = -evt->m_downcount;
-      const TickCount ticks_to_execute = evt->m_time_since_last_run;
-      evt->m_downcount += evt->m_interval;
-      evt->m_time_since_last_run = 0;
+      const TickCount ticks_late = static_cast<TickCount>(s_global_tick_counter - evt->m_next_run_time);
+      const TickCount ticks_to_execute = static_cast<TickCount>(s_global_tick_counter - evt->m_last_run_time);
+      evt->m_next_run_time += static_cast<u32>(evt->m_interval);
+      evt->m_last_run_time = s_global_tick_counter;
+      SiftDown(0);
 
       // The cycles_late is only an indicator, it doesn't modify the cycles to execute.
-      evt->m_callback(ticks_to_execute, ticks_late);
-
-      // Place it in the appropriate position in the queue.
-      if (s_events_need_sorting)
-      {
-        // Another event may have been changed by this event, or the interval/downcount changed.
-        std::make_heap(s_events.begin(), s_events.end(), CompareEvents);
-        s_events_need_sorting = false;
-      }
-      else
-      {
-        // Keep the event list in a heap. The event we just serviced will be in the last place,
-        // so we can use push_here instead of make_heap, which should be faster.
-        std::push_heap(s_events.begin(), s_events.end(), CompareEvents);
-      }
+      InvokeCallback(evt, ticks_to_execute, ticks_late);
     }
+
+    s_global_tick_counter = target_time;
   }
 
   s_last_event_run_time = s_global_tick_counter;
@@ -176,7 +271,8 @@ bool DoState(StateWrapper& sw, u32 global_tick_counter)
 {
   if (sw.IsReading())
   {
-    s_global_tick_counter = global_tick_counter;
+    // Keep any events which aren't in the save state at the same distance from the current time.
+    RebaseEvents(global_tick_counter);
 
     // Load timestamps for the clock events.
     // Any oneshot events should be recreated by the load state method, so we can fix up their times here.
@@ -203,8 +299,8 @@ bool DoState(StateWrapper& sw, u32 global_tick_counter)
       }
 
       // Using reschedule is safe here since we call sort afterwards.
-      event->m_downcount = downcount;
-      event->m_time_since_last_run = time_since_last_run;
+      event->m_next_run_time = s_global_tick_counter + static_cast<u32>(downcount);
+      event->m_last_run_time = s_global_tick_counter - static_cast<u32>(time_since_last_run);
       event->m_period = period;
       event->m_interval = interval;
     }
@@ -221,9 +317,11 @@ bool DoState(StateWrapper& sw, u32 global_tick_counter)
 
     for (TimingEvent* evt : s_events)
     {
+      TickCount downcount = evt->GetDowncount();
+      TickCount time_since_last_run = static_cast<TickCount>(s_global_tick_counter - evt->m_last_run_time);
       sw.Do(&evt->m_name);
-      sw.Do(&evt->m_downcount);
-      sw.Do(&evt->m_time_since_last_run);
+      sw.Do(&downcount);
+      sw.Do(&time_since_last_run);
       sw.Do(&evt->m_period);
       sw.Do(&evt->m_interval);
     }
@@ -236,11 +334,180 @@ bool DoState(StateWrapper& sw, u32 global_tick_counter)
   return !sw.HasError();
 }
 
+void EndProfileFrame()
+{
+  for (auto& it : s_event_profiles)
+  {
+    TimingEventProfile& profile = it.second;
+    profile.last_frame_invocation_count = profile.frame_invocation_count;
+    profile.max_frame_invocation_count = std::max(profile.max_frame_invocation_count, profile.frame_invocation_count);
+    profile.frame_invocation_count = 0;
+  }
+
+  s_profile_frame_count++;
+}
+
+void ResetProfile()
+{
+  // The events keep pointers to their profiles, so they're cleared rather than removed.
+  for (auto& it : s_event_profiles)
+    it.second = {};
+
+  s_profile_frame_count = 0;
+}
+
+static std::vector<std::pair<const std::string*, const TimingEventProfile*>> GetSortedProfiles()
+{
+  std::vector<std::pair<const std::string*, const TimingEventProfile*>> profiles;
+  profiles.reserve(s_event_profiles.size());
+  for (const auto& it : s_event_profiles)
+    profiles.emplace_back(&it.first, &it.second);
+
+  std::sort(profiles.begin(), profiles.end(),
+            [](const auto& lhs, const auto& rhs) { return lhs.second->host_time > rhs.second->host_time; });
+  return profiles;
+}
+
+static void FormatLatenessBucket(char* buf, size_t buf_size, u32 bucket)
+{
+  if (bucket == 0)
+    std::snprintf(buf, buf_size, "0");
+  else if (bucket == 1)
+    std::snprintf(buf, buf_size, "1");
+  else if (bucket == (TimingEventProfile::NUM_LATENESS_BUCKETS - 1))
+    std::snprintf(buf, buf_size, "%u+", 1u << (bucket - 1));
+  else
+    std::snprintf(buf, buf_size, "%u-%u", 1u << (bucket - 1), (1u << bucket) - 1);
+}
+
+static double GetAverageInvocationsPerFrame(const TimingEventProfile& profile)
+{
+  return (s_profile_frame_count > 0) ?
+           (static_cast<double>(profile.invocation_count) / static_cast<double>(s_profile_frame_count)) :
+           0.0;
+}
+
+static double GetNanosecondsPerInvocation(const TimingEventProfile& profile)
+{
+  return (profile.invocation_count > 0) ? (Common::Timer::ConvertValueToNanoseconds(profile.host_time) /
+                                           static_cast<double>(profile.invocation_count)) :
+                                          0.0;
+}
+
+bool WriteProfileCSV(const char* filename)
+{
+  std::FILE* fp = FileSystem::OpenCFile(filename, "wb");
+  if (!fp)
+  {
+    Log_ErrorPrintf("Failed to open '%s' for writing", filename);
+    return false;
+  }
+
+  std::fprintf(fp, "Event,Invocations,Frames,Invocations Per Frame,Last Frame Invocations,Max Frame Invocations,"
+                   "Host Nanoseconds,Nanoseconds Per Invocation");
+  for (u32 i = 0; i < TimingEventProfile::NUM_LATENESS_BUCKETS; i++)
+  {
+    char bucket_name[32];
+    FormatLatenessBucket(bucket_name, sizeof(bucket_name), i);
+    std::fprintf(fp, ",Late %s", bucket_name);
+  }
+  std::fprintf(fp, "\n");
+
+  for (const auto& [name, profile] : GetSortedProfiles())
+  {
+    std::fprintf(fp, "\"%s\",%llu,%u,%.2f,%u,%u,%.0f,%.1f", name->c_str(),
+                 static_cast<unsigned long long>(profile->invocation_count), s_profile_frame_count,
+                 GetAverageInvocationsPerFrame(*profile), profile->last_frame_invocation_count,
+                 profile->max_frame_invocation_count, Common::Timer::ConvertValueToNanoseconds(profile->host_time),
+                 GetNanosecondsPerInvocation(*profile));
+    for (const u64 count : profile->lateness_histogram)
+      std::fprintf(fp, ",%llu", static_cast<unsigned long long>(count));
+    std::fprintf(fp, "\n");
+  }
+
+  std::fclose(fp);
+  Log_InfoPrintf("Wrote timing event profile to '%s'", filename);
+  return true;
+}
+
+void DrawProfileWindow()
+{
+  static constexpr u32 NUM_COLUMNS = 8;
+  static constexpr std::array<const char*, NUM_COLUMNS> column_names = {
+    {"Event", "Invocations", "Per Frame", "Last Frame", "Max Frame", "Host ms", "ns/Call", "Late %"}};
+
+  const float framebuffer_scale = ImGui::GetIO().DisplayFramebufferScale.x;
+
+  ImGui::SetNextWindowSize(ImVec2(800.0f * framebuffer_scale, 350.0f * framebuffer_scale), ImGuiCond_FirstUseEver);
+  if (!ImGui::Begin("Timing Event Profile", &g_settings.debugging.show_timing_event_profile))
+  {
+    ImGui::End();
+    return;
+  }
+
+  if (ImGui::Button("Reset"))
+    ResetProfile();
+  ImGui::SameLine();
+  if (ImGui::Button("Save CSV"))
+    g_host_interface->SaveTimingEventProfile();
+  ImGui::SameLine();
+  ImGui::Text("%u frames", s_profile_frame_count);
+
+  ImGui::Columns(NUM_COLUMNS);
+  for (const char* title : column_names)
+  {
+    ImGui::TextUnformatted(title);
+    ImGui::NextColumn();
+  }
+
+  for (const auto& [name, profile] : GetSortedProfiles())
+  {
+    ImGui::TextUnformatted(name->c_str());
+    ImGui::NextColumn();
+    ImGui::Text("%llu", static_cast<unsigned long long>(profile->invocation_count));
+    ImGui::NextColumn();
+    ImGui::Text("%.1f", GetAverageInvocationsPerFrame(*profile));
+    ImGui::NextColumn();
+    ImGui::Text("%u", profile->last_frame_invocation_count);
+    ImGui::NextColumn();
+    ImGui::Text("%u", profile->max_frame_invocation_count);
+    ImGui::NextColumn();
+    ImGui::Text("%.3f", Common::Timer::ConvertValueToMilliseconds(profile->host_time));
+    ImGui::NextColumn();
+    ImGui::Text("%.1f", GetNanosecondsPerInvocation(*profile));
+    ImGui::NextColumn();
+
+    const u64 on_time = profile->lateness_histogram[0];
+    ImGui::Text("%.2f", (profile->invocation_count > 0) ?
+                          (static_cast<double>(profile->invocation_count - on_time) * 100.0 /
+                           static_cast<double>(profile->invocation_count)) :
+                          0.0);
+    if (ImGui::IsItemHovered())
+    {
+      // Show the full lateness histogram.
+      ImGui::BeginTooltip();
+      for (u32 i = 0; i < TimingEventProfile::NUM_LATENESS_BUCKETS; i++)
+      {
+        char bucket_name[32];
+        FormatLatenessBucket(bucket_name, sizeof(bucket_name), i);
+        ImGui::Text("%s ticks late: %llu", bucket_name, static_cast<unsigned long long>(profile->lateness_histogram[i]));
+      }
+      ImGui::EndTooltip();
+    }
+    ImGui::NextColumn();
+  }
+
+  ImGui::Columns(1);
+  ImGui::End();
+}
+
 } // namespace TimingEvents
 
-TimingEvent::TimingEvent(std::string name, TickCount period, TickCount interval, TimingEventCallback callback)
-  : m_downcount(interval), m_time_since_last_run(0), m_period(period), m_interval(interval),
-    m_callback(std::move(callback)), m_name(std::move(name)), m_active(false)
+TimingEvent::TimingEvent(std::string name, TickCount period, TickCount interval, TimingEventCallback callback,
+                         void* callback_param)
+  : m_next_run_time(static_cast<u32>(interval)), m_last_run_time(0), m_period(period), m_interval(interval),
+    m_callback(callback), m_callback_param(callback_param), m_heap_index(0), m_profile(nullptr), m_name(std::move(name)),
+    m_active(false)
 {
 }
 
@@ -250,33 +517,40 @@ TimingEvent::~TimingEvent()
     TimingEvents::RemoveActiveEvent(this);
 }
 
+TickCount TimingEvent::GetDowncount() const
+{
+  return static_cast<TickCount>(m_active ? (m_next_run_time - TimingEvents::s_global_tick_counter) : m_next_run_time);
+}
+
 TickCount TimingEvent::GetTicksSinceLastExecution() const
 {
-  return CPU::GetPendingTicks() + m_time_since_last_run;
+  const u32 time_since_last_run =
+    (m_active ? TimingEvents::s_global_tick_counter : 0) - m_last_run_time + CPU::GetPendingTicks();
+  return static_cast<TickCount>(time_since_last_run);
 }
 
 TickCount TimingEvent::GetTicksUntilNextExecution() const
 {
-  return std::max(m_downcount - CPU::GetPendingTicks(), static_cast<TickCount>(0));
+  return std::max(GetDowncount() - CPU::GetPendingTicks(), static_cast<TickCount>(0));
 }
 
 void TimingEvent::Schedule(TickCount ticks)
 {
-  const TickCount pending_ticks = CPU::GetPendingTicks();
-  m_downcount = pending_ticks + ticks;
+  const u32 current_time = TimingEvents::s_global_tick_counter + CPU::GetPendingTicks();
+  m_next_run_time = current_time + static_cast<u32>(ticks);
 
   if (!m_active)
   {
     // Event is going active, so we want it to only execute ticks from the current timestamp.
-    m_time_since_last_run = -pending_ticks;
+    m_last_run_time = current_time;
     m_active = true;
     TimingEvents::AddActiveEvent(this);
   }
   else
   {
     // Event is already active, so we leave the time since last run alone, and just modify the downcount.
-    // If this is a call from an IO handler for example, re-sort the event queue.
-    TimingEvents::SortEvents();
+    // If this is a call from an IO handler for example, move the event in the queue.
+    TimingEvents::RescheduleEvent(this);
   }
 }
 
@@ -298,9 +572,9 @@ void TimingEvent::Reset()
   if (!m_active)
     return;
 
-  m_downcount = m_interval;
-  m_time_since_last_run = 0;
-  TimingEvents::SortEvents();
+  m_next_run_time = TimingEvents::s_global_tick_counter + static_cast<u32>(m_interval);
+  m_last_run_time = TimingEvents::s_global_tick_counter;
+  TimingEvents::RescheduleEvent(this);
 }
 
 void TimingEvent::InvokeEarly(bool force /* = false */)
@@ -308,17 +582,16 @@ void TimingEvent::InvokeEarly(bool force /* = false */)
   if (!m_active)
     return;
 
-  const TickCount pending_ticks = CPU::GetPendingTicks();
-  const TickCount ticks_to_execute = m_time_since_last_run + pending_ticks;
+  const u32 current_time = TimingEvents::s_global_tick_counter + CPU::GetPendingTicks();
+  const TickCount ticks_to_execute = static_cast<TickCount>(current_time - m_last_run_time);
   if (!force && ticks_to_execute < m_period)
     return;
 
-  m_downcount = pending_ticks + m_interval;
-  m_time_since_last_run -= ticks_to_execute;
-  m_callback(ticks_to_execute, 0);
+  m_next_run_time = current_time + static_cast<u32>(m_interval);
+  m_last_run_time = current_time;
+  TimingEvents::RescheduleEvent(this);
 
-  // Since we've changed the downcount, we need to re-sort the events.
-  TimingEvents::SortEvents();
+  TimingEvents::InvokeCallback(this, ticks_to_execute, 0);
 }
 
 void TimingEvent::Activate()
@@ -327,9 +600,9 @@ void TimingEvent::Activate()
     return;
 
   // leave the downcount intact
-  const TickCount pending_ticks = CPU::GetPendingTicks();
-  m_downcount += pending_ticks;
-  m_time_since_last_run -= pending_ticks;
+  const u32 current_time = TimingEvents::s_global_tick_counter + CPU::GetPendingTicks();
+  m_next_run_time += current_time;
+  m_last_run_time += current_time;
 
   m_active = true;
   TimingEvents::AddActiveEvent(this);
@@ -340,9 +613,9 @@ void TimingEvent::Deactivate()
   if (!m_active)
     return;
 
-  const TickCount pending_ticks = CPU::GetPendingTicks();
-  m_downcount -= pending_ticks;
-  m_time_since_last_run += pending_ticks;
+  const u32 current_time = TimingEvents::s_global_tick_counter + CPU::GetPendingTicks();
+  m_next_run_time -= current_time;
+  m_last_run_time -= current_time;
 
   m_active = false;
   TimingEvents::RemoveActiveEvent(this);
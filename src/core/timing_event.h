@@ -1,5 +1,5 @@
 #pragma once
-#include <functional>
+#include <array>
 #include <memory>
 #include <string>
 #include <vector>
@@ -8,13 +8,32 @@
 
 class StateWrapper;
 
-// Event callback type. Second parameter is the number of cycles the event was executed "late".
-using TimingEventCallback = std::function<void(TickCount ticks, TickCount ticks_late)>;
+// Event callback type. First parameter is the pointer passed when creating the event, and the last is the number of
+// cycles the event was executed "late".
+using TimingEventCallback = void (*)(void* param, TickCount ticks, TickCount ticks_late);
+
+/// Invocation counts, host time and lateness for one event. Devices destroy and create their events again, e.g. when
+/// the GPU renderer is switched, so these live in a map keyed by event name and an event looks its entry up on its
+/// first profiled invocation.
+struct TimingEventProfile
+{
+  // Bucket 0 counts invocations which were on time, bucket N ones which were 2^(N-1) to 2^N-1 ticks late, and the last
+  // bucket anything later than that.
+  static constexpr u32 NUM_LATENESS_BUCKETS = 12;
+
+  u64 invocation_count;
+  u64 host_time; // in Common::Timer units
+  u32 frame_invocation_count;
+  u32 last_frame_invocation_count;
+  u32 max_frame_invocation_count;
+  std::array<u64, NUM_LATENESS_BUCKETS> lateness_histogram;
+};
 
 class TimingEvent
 {
 public:
-  TimingEvent(std::string name, TickCount period, TickCount interval, TimingEventCallback callback);
+  TimingEvent(std::string name, TickCount period, TickCount interval, TimingEventCallback callback,
+              void* callback_param);
   ~TimingEvent();
 
   const std::string& GetName() const { return m_name; }
@@ -23,7 +42,7 @@ public:
   // Returns the number of ticks between each event.
   ALWAYS_INLINE TickCount GetPeriod() const { return m_period; }
   ALWAYS_INLINE TickCount GetInterval() const { return m_interval; }
-  ALWAYS_INLINE TickCount GetDowncount() const { return m_downcount; }
+  TickCount GetDowncount() const;
 
   // Includes pending time.
   TickCount GetTicksSinceLastExecution() const;
@@ -56,12 +75,22 @@ public:
   void SetInterval(TickCount interval) { m_interval = interval; }
   void SetPeriod(TickCount period) { m_period = period; }
 
-  TickCount m_downcount;
-  TickCount m_time_since_last_run;
+  // Global tick count at which the event next runs, and at which it last ran. While the event is inactive, these are
+  // relative to the time it was deactivated instead.
+  u32 m_next_run_time;
+  u32 m_last_run_time;
   TickCount m_period;
   TickCount m_interval;
 
   TimingEventCallback m_callback;
+  void* m_callback_param;
+
+  // position in the event heap, only valid while active
+  u32 m_heap_index;
+
+  // null until the event runs while profiling
+  TimingEventProfile* m_profile;
+
   std::string m_name;
   bool m_active;
 };
@@ -74,9 +103,9 @@ void Initialize();
 void Reset();
 void Shutdown();
 
-/// Creates a new event.
+/// Creates a new event. The callback parameter is passed through to the callback, and is usually the owning object.
 std::unique_ptr<TimingEvent> CreateTimingEvent(std::string name, TickCount period, TickCount interval,
-                                               TimingEventCallback callback, bool activate);
+                                               TimingEventCallback callback, void* callback_param, bool activate);
 
 /// Serialization.
 bool DoState(StateWrapper& sw, u32 global_tick_counter);
@@ -85,6 +114,18 @@ void RunEvents();
 
 void UpdateCPUDowncount();
 
+/// Rolls the per-frame invocation counts over. Called at the end of each frame while profiling.
+void EndProfileFrame();
+
+/// Clears the profile counters.
+void ResetProfile();
+
+/// Writes the profile counters to a CSV file, one row per event.
+bool WriteProfileCSV(const char* filename);
+
+/// Shows the profile counters in an ImGui window.
+void DrawProfileWindow();
+
 
 
 } // namespace TimingEventManager
\ No newline at end of file
@@ -114,5 +114,10 @@ enum : u32
 enum : u32
 {
   CPU_CODE_CACHE_PAGE_SIZE = 1024,
-  CPU_CODE_CACHE_PAGE_COUNT = 0x200000 / CPU_CODE_CACHE_PAGE_SIZE
+  CPU_CODE_CACHE_PAGE_COUNT = 0x200000 / CPU_CODE_CACHE_PAGE_SIZE,
+
+  // Stores to a code page only invalidate it if they hit one of these ranges which contains code.
+  CPU_CODE_CACHE_RANGE_SIZE = 64,
+  CPU_CODE_CACHE_RANGE_COUNT = 0x200000 / CPU_CODE_CACHE_RANGE_SIZE,
+  CPU_CODE_CACHE_RANGES_PER_PAGE = CPU_CODE_CACHE_PAGE_SIZE / CPU_CODE_CACHE_RANGE_SIZE
 };
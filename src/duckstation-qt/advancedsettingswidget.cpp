@@ -26,6 +26,24 @@ AdvancedSettingsWidget::AdvancedSettingsWidget(QtHostInterface* host_interface,
   SettingWidgetBinder::BindWidgetToIntSetting(m_host_interface, m_ui.gpuMaxRunAhead, "Hacks", "GPUMaxRunAhead");
   SettingWidgetBinder::BindWidgetToBoolSetting(m_host_interface, m_ui.cpuRecompilerMemoryExceptions, "CPU",
                                                "RecompilerMemoryExceptions", false);
+  SettingWidgetBinder::BindWidgetToBoolSetting(m_host_interface, m_ui.cpuFastmem, "CPU", "Fastmem", false);
+  SettingWidgetBinder::BindWidgetToBoolSetting(m_host_interface, m_ui.cpuCodePageProtection, "CPU",
+                                               "CodePageProtection", false);
+  SettingWidgetBinder::BindWidgetToBoolSetting(m_host_interface, m_ui.cpuRecompilerDiskCache, "CPU",
+                                               "RecompilerDiskCache", false);
+  SettingWidgetBinder::BindWidgetToBoolSetting(m_host_interface, m_ui.cpuRecompilerSuperblocks, "CPU",
+                                               "RecompilerSuperblocks", false);
+  SettingWidgetBinder::BindWidgetToBoolSetting(m_host_interface, m_ui.cpuRecompilerTiered, "CPU", "RecompilerTiered",
+                                               false);
+  SettingWidgetBinder::BindWidgetToBoolSetting(m_host_interface, m_ui.cpuRecompilerThread, "CPU", "RecompilerThread",
+                                               false);
+  SettingWidgetBinder::BindWidgetToIntSetting(m_host_interface, m_ui.cpuRecompilerCodeCacheSize, "CPU",
+                                              "RecompilerCodeCacheSize",
+                                              static_cast<int>(Settings::DEFAULT_CPU_RECOMPILER_CODE_CACHE_SIZE));
+  SettingWidgetBinder::BindWidgetToBoolSetting(m_host_interface, m_ui.cpuIdleLoopSkipping, "CPU", "IdleLoopSkipping",
+                                               false);
+  SettingWidgetBinder::BindWidgetToBoolSetting(m_host_interface, m_ui.cpuRecompilerHostExtensions, "CPU",
+                                               "RecompilerHostExtensions", true);
 
   SettingWidgetBinder::BindWidgetToBoolSetting(m_host_interface, m_ui.gpuUseDebugDevice, "GPU", "UseDebugDevice");
 
@@ -45,4 +63,13 @@ void AdvancedSettingsWidget::onResetToDefaultClicked()
   m_ui.gpuFIFOSize->setValue(static_cast<int>(Settings::DEFAULT_GPU_FIFO_SIZE));
   m_ui.gpuMaxRunAhead->setValue(static_cast<int>(Settings::DEFAULT_GPU_MAX_RUN_AHEAD));
   m_ui.cpuRecompilerMemoryExceptions->setChecked(false);
+  m_ui.cpuFastmem->setChecked(false);
+  m_ui.cpuCodePageProtection->setChecked(false);
+  m_ui.cpuRecompilerDiskCache->setChecked(false);
+  m_ui.cpuRecompilerSuperblocks->setChecked(false);
+  m_ui.cpuRecompilerTiered->setChecked(false);
+  m_ui.cpuRecompilerThread->setChecked(false);
+  m_ui.cpuRecompilerCodeCacheSize->setValue(static_cast<int>(Settings::DEFAULT_CPU_RECOMPILER_CODE_CACHE_SIZE));
+  m_ui.cpuIdleLoopSkipping->setChecked(false);
+  m_ui.cpuRecompilerHostExtensions->setChecked(true);
 }
@@ -656,6 +656,10 @@ void MainWindow::connectSignals()
                                                "ShowTimersState");
   SettingWidgetBinder::BindWidgetToBoolSetting(m_host_interface, m_ui.actionDebugShowMDECState, "Debug",
                                                "ShowMDECState");
+  SettingWidgetBinder::BindWidgetToBoolSetting(m_host_interface, m_ui.actionDebugShowCodeCacheProfile, "Debug",
+                                               "ShowCodeCacheProfile");
+  SettingWidgetBinder::BindWidgetToBoolSetting(m_host_interface, m_ui.actionDebugShowTimingEventProfile, "Debug",
+                                               "ShowTimingEventProfile");
 
   addThemeToMenu(tr("Default"), QStringLiteral("default"));
   addThemeToMenu(tr("DarkFusion"), QStringLiteral("darkfusion"));
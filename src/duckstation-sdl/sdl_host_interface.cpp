@@ -939,6 +939,9 @@ void SDLHostInterface::DrawDebugMenu()
   settings_changed |= ImGui::MenuItem("Show SPU State", nullptr, &debug_settings.show_spu_state);
   settings_changed |= ImGui::MenuItem("Show Timers State", nullptr, &debug_settings.show_timers_state);
   settings_changed |= ImGui::MenuItem("Show MDEC State", nullptr, &debug_settings.show_mdec_state);
+  settings_changed |= ImGui::MenuItem("Show Code Cache Profile", nullptr, &debug_settings.show_code_cache_profile);
+  settings_changed |=
+    ImGui::MenuItem("Show Timing Event Profile", nullptr, &debug_settings.show_timing_event_profile);
 
   if (settings_changed)
   {
@@ -952,6 +955,8 @@ void SDLHostInterface::DrawDebugMenu()
     debug_settings_copy.show_spu_state = debug_settings.show_spu_state;
     debug_settings_copy.show_timers_state = debug_settings.show_timers_state;
     debug_settings_copy.show_mdec_state = debug_settings.show_mdec_state;
+    debug_settings_copy.show_code_cache_profile = debug_settings.show_code_cache_profile;
+    debug_settings_copy.show_timing_event_profile = debug_settings.show_timing_event_profile;
     RunLater([this]() { SaveAndUpdateSettings(); });
   }
 }
@@ -1233,6 +1238,25 @@ void SDLHostInterface::DrawSettingsWindow()
 
       settings_changed |=
         ImGui::Checkbox("Enable Recompiler Memory Exceptions", &m_settings_copy.cpu_recompiler_memory_exceptions);
+      settings_changed |= ImGui::Checkbox("Enable Recompiler Fast Memory Access", &m_settings_copy.cpu_fastmem);
+      settings_changed |= ImGui::Checkbox("Enable Code Page Protection", &m_settings_copy.cpu_code_page_protection);
+      settings_changed |= ImGui::Checkbox("Enable Recompiler Disk Cache", &m_settings_copy.cpu_recompiler_disk_cache);
+      settings_changed |= ImGui::Checkbox("Enable Recompiler Superblocks", &m_settings_copy.cpu_recompiler_superblocks);
+      settings_changed |= ImGui::Checkbox("Enable Tiered Recompilation", &m_settings_copy.cpu_recompiler_tiered);
+      settings_changed |= ImGui::Checkbox("Enable Recompiler Thread", &m_settings_copy.cpu_recompiler_thread);
+      settings_changed |= ImGui::Checkbox("Enable Idle Loop Skipping", &m_settings_copy.cpu_idle_loop_skipping);
+      settings_changed |=
+        ImGui::Checkbox("Use Recompiler Host Extensions", &m_settings_copy.cpu_recompiler_host_extensions);
+
+      ImGui::Text("Code Cache Size (MB):");
+      ImGui::SameLine(indent);
+
+      int code_cache_size = static_cast<int>(m_settings_copy.cpu_recompiler_code_cache_size);
+      if (ImGui::SliderInt("##code_cache_size", &code_cache_size, 8, 128))
+      {
+        m_settings_copy.cpu_recompiler_code_cache_size = static_cast<u32>(code_cache_size);
+        settings_changed = true;
+      }
 
       ImGui::EndTabItem();
     }
@@ -19,6 +19,7 @@
 #include "core/spu.h"
 #include "core/system.h"
 #include "core/timers.h"
+#include "core/timing_event.h"
 #include "imgui.h"
 #include "ini_settings_interface.h"
 #include "save_state_selector_ui.h"
@@ -860,6 +861,10 @@ void CommonHostInterface::DrawDebugWindows()
     g_spu.DrawDebugStateWindow();
   if (g_settings.debugging.show_mdec_state)
     g_mdec.DrawDebugStateWindow();
+  if (g_settings.debugging.show_code_cache_profile)
+    CPU::CodeCache::DrawProfileWindow();
+  if (g_settings.debugging.show_timing_event_profile)
+    TimingEvents::DrawProfileWindow();
 }
 
 void CommonHostInterface::DoFrameStep()
@@ -1281,6 +1286,12 @@ void CommonHostInterface::RegisterGeneralHotkeys()
                      SaveScreenshot();
                  });
 
+  RegisterHotkey(StaticString("General"), StaticString("DumpTimingEventProfile"),
+                 StaticString("Dump Timing Event Profile"), [this](bool pressed) {
+                   if (!pressed && System::IsValid())
+                     SaveTimingEventProfile();
+                 });
+
   RegisterHotkey(StaticString("General"), StaticString("FrameStep"), StaticString("Frame Step"), [this](bool pressed) {
     if (!pressed)
     {
@@ -1307,6 +1318,8 @@ void CommonHostInterface::RegisterGraphicsHotkeys()
 
                      if (g_settings.gpu_pgxp_enable)
                        PGXP::Initialize();
+                     else
+                       PGXP::Shutdown();
 
                      // we need to recompile all blocks if pgxp is toggled on/off
                      if (g_settings.IsUsingCodeCache())